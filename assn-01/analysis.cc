@@ -0,0 +1,314 @@
+/**
+ * File: analysis.cc
+ * -----------------
+ * Implements analyzeGrammar and printReport.  Tokens are
+ * classified the same way the Grammar compiler classifies them:
+ * a token is a nonterminal exactly when it starts with '<'.
+ */
+
+#include "analysis.h"
+#include <math.h>
+#include <algorithm>
+#include <iomanip>
+
+/**
+ * The analysis works over a numbered copy of the grammar: every
+ * nonterminal, defined or not, gets an index, and each production
+ * is reduced to the probability it's chosen with, the number of
+ * terminals it contains, and the indices of its nonterminals.
+ */
+
+struct expansion {
+  double probability;
+  int numTerminals;
+  vector<int> nonterminals;
+};
+
+struct nonterminalInfo {
+  string name;
+  bool defined;
+  vector<expansion> expansions;
+};
+
+static int getIndex(const string& name, map<string, int>& indices, vector<nonterminalInfo>& nonterminals)
+{
+  map<string, int>::iterator found = indices.find(name);
+  if (found != indices.end()) return found->second;
+  int index = nonterminals.size();
+  indices[name] = index;
+  nonterminalInfo info;
+  info.name = name;
+  info.defined = false;
+  nonterminals.push_back(info);
+  return index;
+}
+
+static void numberGrammar(const map<string, Definition>& grammar, map<string, int>& indices,
+                          vector<nonterminalInfo>& nonterminals)
+{
+  for (map<string, Definition>::const_iterator curr = grammar.begin(); curr != grammar.end(); curr++)
+    nonterminals[getIndex(curr->first, indices, nonterminals)].defined = true;
+
+  for (map<string, Definition>::const_iterator curr = grammar.begin(); curr != grammar.end(); curr++) {
+    double totalWeight = 0;
+    for (Definition::const_iterator prod = curr->second.begin(); prod != curr->second.end(); prod++)
+      totalWeight += prod->getWeight();
+
+    vector<expansion> expansions;
+    for (Definition::const_iterator prod = curr->second.begin(); prod != curr->second.end(); prod++) {
+      expansion exp;
+      exp.probability = prod->getWeight() / totalWeight;
+      exp.numTerminals = 0;
+      for (Production::const_iterator word = prod->begin(); word != prod->end(); word++) {
+        if (word->length() && (*word)[0] == '<')
+          exp.nonterminals.push_back(getIndex(*word, indices, nonterminals));
+        else exp.numTerminals++;
+      }
+      expansions.push_back(exp);
+    }
+    nonterminals[indices[curr->first]].expansions = expansions;
+  }
+}
+
+/**
+ * A nonterminal is productive if one of its productions mentions
+ * only terminals and productive nonterminals.  Nothing is productive
+ * to begin with, and the set only grows, so passes over the grammar
+ * are repeated until one of them discovers nothing new.
+ */
+
+static void findProductive(const vector<nonterminalInfo>& nonterminals, vector<bool>& productive)
+{
+  productive.assign(nonterminals.size(), false);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t i = 0; i < nonterminals.size(); i++) {
+      if (productive[i]) continue;
+      for (size_t e = 0; e < nonterminals[i].expansions.size() && !productive[i]; e++) {
+        const vector<int>& mentioned = nonterminals[i].expansions[e].nonterminals;
+        bool allProductive = true;
+        for (size_t j = 0; j < mentioned.size() && allProductive; j++)
+          allProductive = productive[mentioned[j]];
+        if (allProductive) productive[i] = changed = true;
+      }
+    }
+  }
+}
+
+static void findReachable(const vector<nonterminalInfo>& nonterminals, int start, vector<bool>& reachable)
+{
+  reachable.assign(nonterminals.size(), false);
+  vector<int> pending(1, start);
+  reachable[start] = true;
+  while (!pending.empty()) {
+    int curr = pending.back();
+    pending.pop_back();
+    for (size_t e = 0; e < nonterminals[curr].expansions.size(); e++) {
+      const vector<int>& mentioned = nonterminals[curr].expansions[e].nonterminals;
+      for (size_t j = 0; j < mentioned.size(); j++) {
+        if (reachable[mentioned[j]]) continue;
+        reachable[mentioned[j]] = true;
+        pending.push_back(mentioned[j]);
+      }
+    }
+  }
+}
+
+/**
+ * Tarjan's algorithm, which conveniently completes each strongly
+ * connected component only after every component it can reach, so
+ * components are appended to components in exactly the order their
+ * expected lengths need to be computed in.
+ */
+
+struct componentSearch {
+  const vector<nonterminalInfo>& nonterminals;
+  vector<int> order, lowLink;
+  vector<bool> onStack;
+  vector<int> stack;
+  int counter;
+  vector<vector<int> > components;
+
+  componentSearch(const vector<nonterminalInfo>& nonterminals) :
+    nonterminals(nonterminals), order(nonterminals.size(), -1),
+    lowLink(nonterminals.size()), onStack(nonterminals.size(), false), counter(0) {}
+
+  void visit(int v) {
+    order[v] = lowLink[v] = counter++;
+    stack.push_back(v);
+    onStack[v] = true;
+    for (size_t e = 0; e < nonterminals[v].expansions.size(); e++) {
+      const vector<int>& mentioned = nonterminals[v].expansions[e].nonterminals;
+      for (size_t j = 0; j < mentioned.size(); j++) {
+        int w = mentioned[j];
+        if (order[w] == -1) {
+          visit(w);
+          lowLink[v] = min(lowLink[v], lowLink[w]);
+        } else if (onStack[w]) {
+          lowLink[v] = min(lowLink[v], order[w]);
+        }
+      }
+    }
+
+    if (lowLink[v] != order[v]) return;
+    vector<int> component;
+    int w;
+    do {
+      w = stack.back();
+      stack.pop_back();
+      onStack[w] = false;
+      component.push_back(w);
+    } while (w != v);
+    components.push_back(component);
+  }
+};
+
+/**
+ * Solves the n-by-n system a * x = b in place by Gaussian
+ * elimination with partial pivoting, leaving x in b.
+ *
+ * @return false if the system is (numerically) singular.
+ */
+
+static bool solve(vector<vector<double> >& a, vector<double>& b)
+{
+  int n = b.size();
+  for (int col = 0; col < n; col++) {
+    int pivot = col;
+    for (int row = col + 1; row < n; row++)
+      if (fabs(a[row][col]) > fabs(a[pivot][col])) pivot = row;
+    if (fabs(a[pivot][col]) < 1e-12) return false;
+    swap(a[col], a[pivot]);
+    swap(b[col], b[pivot]);
+    for (int row = col + 1; row < n; row++) {
+      double factor = a[row][col] / a[col][col];
+      if (factor == 0) continue;
+      for (int k = col; k < n; k++) a[row][k] -= factor * a[col][k];
+      b[row] -= factor * b[col];
+    }
+  }
+
+  for (int row = n - 1; row >= 0; row--) {
+    for (int k = row + 1; k < n; k++) b[row] -= a[row][k] * b[k];
+    b[row] /= a[row][row];
+  }
+  return true;
+}
+
+/**
+ * The expected lengths E satisfy one linear equation per nonterminal:
+ *
+ *     E[n] = sum over n's productions p of prob(p) * (terminals(p) + sum of E[m] for each m in p)
+ *
+ * Components are solved one at a time, after everything they refer to
+ * outside themselves is already known.  A component is infinite if it
+ * has an undefined member or refers to an infinite nonterminal (every
+ * member reaches every other with nonzero probability, so one
+ * infinite member makes them all infinite).  Otherwise its system is
+ * solved directly.  A finite expected length exists exactly when the
+ * component's matrix of expected nonterminal counts has spectral
+ * radius below 1, and in that case (Perron-Frobenius) the solution is
+ * nonnegative; a singular system or a negative solution means the
+ * expansion is critical or supercritical, and the expected length is
+ * unbounded.
+ */
+
+static void computeExpectedLengths(const vector<nonterminalInfo>& nonterminals, vector<double>& lengths)
+{
+  componentSearch search(nonterminals);
+  for (size_t v = 0; v < nonterminals.size(); v++)
+    if (search.order[v] == -1) search.visit(v);
+
+  lengths.assign(nonterminals.size(), HUGE_VAL);
+  vector<int> position(nonterminals.size(), -1);
+  for (size_t c = 0; c < search.components.size(); c++) {
+    const vector<int>& component = search.components[c];
+    int n = component.size();
+    for (int i = 0; i < n; i++) position[component[i]] = i;
+
+    vector<vector<double> > a(n, vector<double>(n, 0.0));
+    vector<double> b(n, 0.0);
+    bool infinite = false;
+    for (int i = 0; i < n && !infinite; i++) {
+      const nonterminalInfo& info = nonterminals[component[i]];
+      if (!info.defined) infinite = true;
+      a[i][i] = 1.0;
+      for (size_t e = 0; e < info.expansions.size() && !infinite; e++) {
+        const expansion& exp = info.expansions[e];
+        b[i] += exp.probability * exp.numTerminals;
+        for (size_t j = 0; j < exp.nonterminals.size(); j++) {
+          int m = exp.nonterminals[j];
+          if (position[m] != -1) a[i][position[m]] -= exp.probability;
+          else if (lengths[m] == HUGE_VAL) infinite = true;
+          else b[i] += exp.probability * lengths[m];
+        }
+      }
+    }
+
+    if (!infinite && solve(a, b)) {
+      for (int i = 0; i < n && !infinite; i++)
+        infinite = !(b[i] >= -1e-9 && b[i] < HUGE_VAL);
+      for (int i = 0; i < n && !infinite; i++)
+        lengths[component[i]] = max(b[i], 0.0);
+    }
+
+    for (int i = 0; i < n; i++) position[component[i]] = -1;
+  }
+}
+
+void analyzeGrammar(const map<string, Definition>& grammar, const string& start, grammarReport& report)
+{
+  map<string, int> indices;
+  vector<nonterminalInfo> nonterminals;
+  getIndex(start, indices, nonterminals);
+  numberGrammar(grammar, indices, nonterminals);
+
+  vector<bool> productive, reachable;
+  vector<double> lengths;
+  findProductive(nonterminals, productive);
+  findReachable(nonterminals, indices[start], reachable);
+  computeExpectedLengths(nonterminals, lengths);
+
+  report.start = start;
+  report.numDefined = grammar.size();
+  report.undefined.clear();
+  report.unreachable.clear();
+  report.nonproductive.clear();
+  report.expectedLengths.clear();
+  report.fatal = false;
+  for (map<string, int>::const_iterator curr = indices.begin(); curr != indices.end(); curr++) {
+    int i = curr->second;
+    if (!nonterminals[i].defined) report.undefined.push_back(curr->first);
+    else if (!reachable[i]) report.unreachable.push_back(curr->first);
+    if (nonterminals[i].defined && !productive[i]) report.nonproductive.push_back(curr->first);
+    if (nonterminals[i].defined) report.expectedLengths[curr->first] = lengths[i];
+    if (reachable[i] && !productive[i]) report.fatal = true;  // undefined ones aren't productive either
+  }
+}
+
+static void printNames(const char *heading, const vector<string>& names, ostream& out)
+{
+  if (names.empty()) return;
+  out << heading << ":";
+  for (size_t i = 0; i < names.size(); i++) out << " " << names[i];
+  out << endl;
+}
+
+void printReport(const grammarReport& report, ostream& out)
+{
+  out << report.numDefined << " nonterminals defined, " << report.undefined.size() << " undefined, "
+      << report.unreachable.size() << " unreachable from " << report.start << ", "
+      << report.nonproductive.size() << " nonproductive." << endl;
+  printNames("Undefined", report.undefined, out);
+  printNames("Unreachable", report.unreachable, out);
+  printNames("Nonproductive", report.nonproductive, out);
+
+  out << "Expected number of words per expansion:" << endl;
+  for (map<string, double>::const_iterator curr = report.expectedLengths.begin();
+       curr != report.expectedLengths.end(); curr++) {
+    out << "  " << left << setw(30) << curr->first << " ";
+    if (curr->second == HUGE_VAL) out << "unbounded" << endl;
+    else out << fixed << setprecision(1) << curr->second << endl;
+  }
+}
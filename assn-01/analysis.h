@@ -0,0 +1,63 @@
+#ifndef __analysis__
+#define __analysis__
+
+/**
+ * File: analysis.h
+ * ----------------
+ * Provides a static analysis of a grammar, run over the
+ * map<string, Definition> built by readGrammar before any text
+ * is generated.  It finds the problems that otherwise only show up
+ * at runtime--nonterminals that are used but never defined, ones
+ * that can never expand to a finite string of terminals, ones that
+ * are never used at all--and it computes how many words each
+ * nonterminal is expected to expand to, which is infinite for
+ * grammars that are likely to run away.
+ */
+
+#include "definition.h"
+#include <map>
+#include <string>
+#include <vector>
+#include <iostream>
+using namespace std;
+
+/**
+ * Everything analyzeGrammar learns about a grammar.  Names always
+ * include the '<' and '>'.  Expected lengths are the expected number
+ * of terminals an expansion produces when every choice is made the way
+ * Definition::getRandomProduction makes it (uniformly, unless the
+ * productions are weighted), and are HUGE_VAL for nonterminals whose
+ * expected length is unbounded.
+ */
+
+struct grammarReport {
+  string start;
+  int numDefined;
+  vector<string> undefined;        // used by some production, but never defined
+  vector<string> unreachable;      // defined, but can't be reached from start
+  vector<string> nonproductive;    // can't expand to a finite string of terminals
+  map<string, double> expectedLengths;
+  bool fatal;                      // some nonterminal reachable from start is undefined or nonproductive
+};
+
+/**
+ * Function: analyzeGrammar
+ * ------------------------
+ * Analyzes the specified grammar and fills in report.
+ *
+ * @param grammar the map populated by readGrammar.
+ * @param start the nonterminal expansions begin with, typically "<start>".
+ * @param report the grammarReport to fill in.
+ */
+
+void analyzeGrammar(const map<string, Definition>& grammar, const string& start, grammarReport& report);
+
+/**
+ * Function: printReport
+ * ---------------------
+ * Publishes the report in a human-readable form.
+ */
+
+void printReport(const grammarReport& report, ostream& out);
+
+#endif // ! __analysis__
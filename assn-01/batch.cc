@@ -0,0 +1,176 @@
+/**
+ * File: batch.cc
+ * --------------
+ * Implements rsg's multi-threaded batch mode.  A fixed set of
+ * workers claim chunks from a shared counter and expand each one
+ * into a slot of a small ring of buffers, while the calling thread
+ * writes the slots out in chunk order.  A worker never gets more
+ * than a ring's length ahead of the writer, so memory stays bounded
+ * however many sentences are asked for.
+ */
+
+#include "batch.h"
+#include "expander.h"
+#include "random.h"
+#include "textwriter.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+static const long kSentencesPerChunk = 4096;
+
+/**
+ * What one worker hands back for one chunk.
+ */
+
+struct chunkResult {
+  TextWriter text;     // in memory, since chunks must be written out in order
+  long numRedrawn;     // sentences that exceeded the limits and were drawn again
+  batchStatus status;  // kBatchComplete, or why the chunk was cut short
+};
+
+/**
+ * Function: generateChunk
+ * -----------------------
+ * Runs on a worker thread.  Expands the sentences making up the
+ * specified chunk straight into the result's TextWriter, which is
+ * cleared first.  Whatever a sentence that exceeds the limits managed
+ * to write is cut back off, and the sentence is drawn again from the
+ * same stream, which keeps the chunk's text a function of the seed.
+ * The chunk is abandoned as soon as its text outgrows maxBytes.
+ */
+
+static void generateChunk(const Grammar& grammar, int symbol, const batchOptions& options,
+                          long chunk, size_t maxBytes, chunkResult& result)
+{
+  RandomGenerator random(options.seed, chunk);  // every chunk gets its own stream
+  Expander expander(grammar, random, options.maxDepth, options.maxTokens);
+  long first = chunk * kSentencesPerChunk;
+  long last = min(first + kSentencesPerChunk, options.count);
+
+  result.text.clear();
+  result.numRedrawn = 0;
+  result.status = kBatchComplete;
+  for (long i = first; i < last; i++) {
+    size_t sentenceStart = result.text.getText().size();
+    for (int tries = 1; !expander.expand(symbol, result.text); tries++) {
+      result.text.truncate(sentenceStart);
+      result.numRedrawn++;
+      if (tries == kMaxRedraws) {
+        result.status = kBatchTooDeep;
+        return;
+      }
+    }
+    result.text.endText();
+    result.text.write("\n");
+    if (result.text.getText().size() > maxBytes) {
+      result.status = kBatchTooLarge;
+      return;
+    }
+  }
+}
+
+/**
+ * The state the workers and the writer share.  nextChunk is the only
+ * part the workers touch without holding lock; everything else,
+ * including which slots are ready, is guarded by it.
+ */
+
+struct batchRun {
+  atomic<long> nextChunk;        // the next chunk nobody has claimed yet
+  mutex lock;
+  condition_variable changed;    // signalled whenever a slot fills or empties
+  long numWritten;               // chunks the writer is done with
+  bool stopped;                  // set by the writer to send every worker home
+  vector<chunkResult> slots;     // chunk c goes in slots[c % slots.size()]
+  vector<bool> ready;
+
+  batchRun(long numSlots) : nextChunk(0), numWritten(0), stopped(false), slots(numSlots), ready(numSlots, false) {}
+};
+
+/**
+ * Function: runWorker
+ * -------------------
+ * Claims chunks until there are none left (or the writer gives up),
+ * waiting before each one until its slot has been written out.
+ */
+
+static void runWorker(const Grammar& grammar, int symbol, const batchOptions& options, long numChunks,
+                      size_t maxBytes, batchRun& run)
+{
+  long numSlots = run.slots.size();
+  for (long chunk = run.nextChunk++; chunk < numChunks; chunk = run.nextChunk++) {
+    {
+      unique_lock<mutex> held(run.lock);
+      run.changed.wait(held, [&] { return run.stopped || chunk < run.numWritten + numSlots; });
+      if (run.stopped) return;
+    }
+    chunkResult& result = run.slots[chunk % numSlots];
+    generateChunk(grammar, symbol, options, chunk, maxBytes, result);
+    lock_guard<mutex> held(run.lock);
+    run.ready[chunk % numSlots] = true;
+    run.changed.notify_all();
+  }
+}
+
+batchStatus generateBatch(const Grammar& grammar, int symbol, const batchOptions& options, TextWriter& out,
+                          long& numRedrawn)
+{
+  long numChunks = (options.count + kSentencesPerChunk - 1) / kSentencesPerChunk;
+  int numWorkers = min((long) options.threads, numChunks);
+  size_t maxBytes = options.maxBytes == 0 ? SIZE_MAX : options.maxBytes;
+  size_t numBytes = 0;
+  numRedrawn = 0;
+  if (numWorkers <= 1) {
+    chunkResult result;  // no point spawning a thread
+    for (long chunk = 0; chunk < numChunks; chunk++) {
+      generateChunk(grammar, symbol, options, chunk, maxBytes - numBytes, result);
+      numRedrawn += result.numRedrawn;
+      if (result.status != kBatchComplete) return result.status;
+      numBytes += result.text.getText().size();
+      out.write(result.text.getText());
+    }
+    return out.flush() ? kBatchComplete : kBatchWriteFailed;
+  }
+
+  batchRun run(2 * numWorkers);  // enough for every worker to start one chunk while the writer catches up
+  vector<thread> workers;
+  for (int i = 0; i < numWorkers; i++)
+    workers.push_back(thread(runWorker, cref(grammar), symbol, cref(options), numChunks, maxBytes,
+                             ref(run)));
+
+  batchStatus status = kBatchComplete;
+  for (long chunk = 0; chunk < numChunks; chunk++) {
+    long slot = chunk % run.slots.size();
+    {
+      unique_lock<mutex> held(run.lock);
+      run.changed.wait(held, [&] { return run.ready[slot]; });
+    }
+    const chunkResult& result = run.slots[slot];
+    numRedrawn += result.numRedrawn;
+    numBytes += result.text.getText().size();
+    status = numBytes > maxBytes ? kBatchTooLarge : result.status;
+    if (status != kBatchComplete) break;
+    out.write(result.text.getText());  // the slot is ours until numWritten moves past it
+    lock_guard<mutex> held(run.lock);
+    run.ready[slot] = false;
+    run.numWritten++;
+    run.changed.notify_all();
+  }
+
+  {
+    lock_guard<mutex> held(run.lock);
+    run.stopped = true;
+    run.changed.notify_all();
+  }
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+  if (status != kBatchComplete) return status;
+  return out.flush() ? kBatchComplete : kBatchWriteFailed;
+}
@@ -0,0 +1,70 @@
+#ifndef __batch__
+#define __batch__
+
+/**
+ * File: batch.h
+ * -------------
+ * Provides rsg's batch mode, which generates a large number of
+ * sentences from one Grammar across several threads.
+ */
+
+#include "grammar.h"
+#include "textwriter.h"
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Bundles the knobs that control a batch run.
+ */
+
+struct batchOptions {
+  long count;          // number of sentences to generate
+  int threads;         // number of worker threads
+  uint64_t seed;       // seed the whole run is derived from
+  int maxDepth;        // per-sentence limits handed to each Expander
+  int maxTokens;
+  size_t maxBytes;     // the most text the run may produce, or 0 for no limit
+};
+
+/**
+ * How a batch run ended.
+ */
+
+enum batchStatus {
+  kBatchComplete,      // every sentence was generated and written
+  kBatchTooDeep,       // some sentence kept growing past the limits, however often it was redrawn
+  kBatchTooLarge,      // the text would have run past options.maxBytes
+  kBatchWriteFailed    // the output couldn't be written
+};
+
+/**
+ * Function: generateBatch
+ * -----------------------
+ * Generates options.count sentences from the specified symbol
+ * and writes them to out, each one wrapped into lines and followed
+ * by a blank line.  The sentences are split into fixed-size
+ * chunks; each chunk is expanded by one of a fixed set of worker
+ * threads into a buffer of its own, using a RandomGenerator seeded
+ * with the run's seed and set to the stream numbered after the chunk.  The Grammar
+ * is the only thing the threads share, and the output depends on the
+ * seed alone, not on the number of threads.  A sentence that grows
+ * past either limit is thrown away and drawn again from the chunk's
+ * own stream, so a complete run always holds exactly options.count
+ * sentences.  A sentence that's still too big after kMaxRedraws tries
+ * ends the run, as does text that runs past options.maxBytes; in either
+ * case whatever was already written to out stays there.
+ *
+ * @param grammar the compiled grammar, shared read-only by all workers.
+ * @param symbol the symbol each sentence is expanded from.
+ * @param options the count, thread, seed, and limit settings.
+ * @param out the TextWriter the finished chunks are written to, in order.
+ * @param numRedrawn set to the number of sentences thrown away for exceeding the limits.
+ * @return kBatchComplete, or else what went wrong.
+ */
+
+static const int kMaxRedraws = 100;
+
+batchStatus generateBatch(const Grammar& grammar, int symbol, const batchOptions& options, TextWriter& out,
+                          long& numRedrawn);
+
+#endif // ! __batch__
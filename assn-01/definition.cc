@@ -8,7 +8,6 @@
  */ 
  
 #include "definition.h"
-#include "random.h"
 
 /**
  * Constructor: Definition
@@ -19,6 +18,8 @@
  * constructor which also takes an ifstream reference.
  * The strong assumption is that the file reference is
  * poised to read the opening '{' as the very first character.
+ * If any of the Productions are weighted, the alias table
+ * used to choose among them is built here, once.
  */
 
 Definition::Definition(ifstream& infile)
@@ -28,12 +29,20 @@ Definition::Definition(ifstream& infile)
   infile >> nonterminal;
   getline(infile, uselessText); // stop character defaults to '\n'
 
-  while (infile.peek() != '}') {
+  while (infile && infile.peek() != '}') {
     Production possibleExpansion(infile);
     possibleExpansions.push_back(possibleExpansion);
   }
   
   getline(infile, uselessText, '}');
+
+  vector<double> weights;
+  bool weighted = false;
+  for (size_t i = 0; i < possibleExpansions.size(); i++) {
+    weights.push_back(possibleExpansions[i].getWeight());
+    if (weights.back() != 1.0) weighted = true;
+  }
+  if (weighted) buildAliasTable(weights, aliasThresholds, aliases);
 }
 
 /**
@@ -48,6 +57,13 @@ Definition::Definition(ifstream& infile)
 const Production& Definition::getRandomProduction() const
 {
   static RandomGenerator random; 
-  int randomIndex = random.getRandomInteger(0, possibleExpansions.size() - 1);
+  return getRandomProduction(random);
+}
+
+const Production& Definition::getRandomProduction(RandomGenerator& random) const
+{
+  int randomIndex = isWeighted() ?
+    random.getWeightedInteger(aliasThresholds.data(), aliases.data(), aliases.size()) :
+    random.getRandomInteger(0, possibleExpansions.size() - 1);
   return possibleExpansions[randomIndex];
 }
@@ -11,6 +11,7 @@
  */
 
 #include "production.h"
+#include "random.h"
 #include <vector>
 using namespace std;  
 
@@ -51,7 +52,8 @@ class Definition {
    * The ifstream must be poised to read the '{' as
    * the very next character, and it consumes everything up
    * to and including the '}' character.  The file is assumed
-   * to be properly formatted.
+   * to be properly formatted; if some Production can't be read
+   * anyway, the constructor stops there and leaves infile failed.
    *
    * @param infile a reference to the flat text grammar file being read.
    *               We assume that the stream pointer is directly addressing
@@ -80,7 +82,8 @@ class Definition {
    * ---------------------------
    * Returns an immutable reference to one and
    * exactly one of the Definition's expansions.
-   * The Production is chosen at random.
+   * The Production is chosen at random, in proportion
+   * to its weight.
    *
    * @return an immutable reference to a randomly selected
    *         Production held by the Definition.  It is assumed
@@ -88,10 +91,49 @@ class Definition {
    */
   
   const Production& getRandomProduction() const;
+
+  /**
+   * Method: getRandomProduction
+   * ---------------------------
+   * Identical to the above, except that the choice is made with
+   * the caller's RandomGenerator instead of one shared by every
+   * Definition, which makes the choice reproducible and safe to
+   * make from several threads at once.
+   *
+   * @param random the generator that makes the choice.
+   * @return an immutable reference to a randomly selected
+   *         Production held by the Definition.
+   */
+
+  const Production& getRandomProduction(RandomGenerator& random) const;
+
+  /**
+   * Iterators: begin, end
+   * ---------------------
+   * Provide read-only, STL-like access to every one of
+   * the Definition's Productions, in the order they were
+   * read from the grammar file.
+   */
+
+  typedef vector<Production>::const_iterator const_iterator;
+  const_iterator begin() const { return possibleExpansions.begin(); }
+  const_iterator end() const { return possibleExpansions.end(); }
   
+  /**
+   * Method: isWeighted
+   * ------------------
+   * Returns true if and only if some Production carries a weight
+   * other than 1, in which case choices are made with an alias table
+   * rather than with a single uniform draw.
+   */
+
+  bool isWeighted() const { return !aliases.empty(); }
+
  private:
   string nonterminal;
   vector<Production> possibleExpansions;
+  vector<uint32_t> aliasThresholds;  // both empty unless the Definition is weighted
+  vector<int> aliases;
 };
 
 #endif // ! __definition__
@@ -0,0 +1,84 @@
+/**
+ * File: expander.cc
+ * -----------------
+ * Provides the implementation of the Expander class.
+ */
+
+#include "expander.h"
+
+Expander::Expander(const Grammar& grammar, RandomGenerator& random, int maxDepth, int maxTokens) :
+  grammar(grammar), random(random), maxDepth(maxDepth), maxTokens(maxTokens) {}
+
+/**
+ * Functions: emit
+ * ---------------
+ * The two kinds of sink expandInto knows how to send a span
+ * to: vectors get its words one by one, and TextWriters get
+ * it whole.
+ */
+
+static inline void emit(vector<string_view>& dest, string_view span, int)
+  { Grammar::splitSpan(span, dest); }
+static inline void emit(TextWriter& writer, string_view span, int numWords)
+  { writer.writeSpan(span, numWords); }
+
+/**
+ * Method: expandInto
+ * ------------------
+ * Each stack frame is one production whose symbols are being
+ * expanded left to right.  A nonterminal is given its production
+ * the moment it's reached, and its frame is pushed on top of the
+ * one that reached it, which is precisely the order in which the
+ * recursive version consults the random number generator.
+ */
+
+template <typename Sink>
+bool Expander::expandInto(int symbol, Sink& sink)
+{
+  if (!Grammar::isNonterminal(symbol)) {
+    int span = Grammar::getSpanIndex(symbol);
+    emit(sink, grammar.getSpan(span), grammar.getSpanWordCount(span));
+    return true;
+  }
+
+  int numTokens = 0;
+  stack.clear();
+  int production = grammar.getRandomProduction(symbol, random);
+  stack.push_back({grammar.productionBegin(production), grammar.productionEnd(production)});
+
+  while (!stack.empty()) {
+    frame& top = stack.back();
+    if (top.curr == top.end) {
+      stack.pop_back();
+      continue;
+    }
+
+    int next = *top.curr++;
+    if (!Grammar::isNonterminal(next)) {
+      int span = Grammar::getSpanIndex(next);
+      int numWords = grammar.getSpanWordCount(span);
+      if (numWords > maxTokens - numTokens) return false;
+      emit(sink, grammar.getSpan(span), numWords);
+      numTokens += numWords;
+    } else {
+      if ((int) stack.size() == maxDepth) return false;
+      production = grammar.getRandomProduction(next, random);
+      stack.push_back({grammar.productionBegin(production), grammar.productionEnd(production)});
+    }
+  }
+
+  return true;
+}
+
+bool Expander::expand(int symbol, vector<string_view>& dest)
+{
+  size_t originalSize = dest.size();
+  if (expandInto(symbol, dest)) return true;
+  dest.resize(originalSize);
+  return false;
+}
+
+bool Expander::expand(int symbol, TextWriter& writer)
+{
+  return expandInto(symbol, writer);
+}
@@ -0,0 +1,101 @@
+#ifndef __expander__
+#define __expander__
+
+/**
+ * File: expander.h
+ * ----------------
+ * Defines the Expander class, which generates text from a
+ * compiled Grammar without recursing.  Grammar::expand recurses
+ * once per nonterminal, so a deeply nested derivation (math.g
+ * produces them all the time) can overflow the native stack.  An
+ * Expander instead keeps its own explicit stack of partially
+ * traversed productions, which it reuses from one expansion to the
+ * next, and it refuses to let any one expansion grow past a
+ * configurable depth or number of tokens.
+ */
+
+#include "grammar.h"
+#include "random.h"
+#include "textwriter.h"
+#include <string_view>
+#include <vector>
+using namespace std;
+
+class Expander {
+
+ public:
+
+  static const int kDefaultMaxDepth = 10000;
+  static const int kDefaultMaxTokens = 1000000;
+
+  /**
+   * Constructor: Expander
+   * ---------------------
+   * Constructs an Expander layered over the specified Grammar
+   * and RandomGenerator, both of which must outlive it.  An
+   * Expander is meant to be owned by a single thread; any number
+   * of them can share the same Grammar.
+   *
+   * @param grammar the compiled grammar to generate text from.
+   * @param random the source of every production choice.
+   * @param maxDepth the most nonterminals that may be in the
+   *                 middle of being expanded at any one time.
+   * @param maxTokens the most terminals any one expansion may produce.
+   */
+
+  Expander(const Grammar& grammar, RandomGenerator& random,
+           int maxDepth = kDefaultMaxDepth, int maxTokens = kDefaultMaxTokens);
+
+  /**
+   * Method: expand
+   * --------------
+   * Expands the specified symbol all the way down to terminals,
+   * appending string_views into the Grammar's span table to
+   * dest.  Given the same stream of random numbers, the terminals
+   * produced are exactly those Grammar::expand would produce.  If
+   * either limit is exceeded, the expansion is abandoned as soon as
+   * that's discovered, dest is restored to its original size, and
+   * false is returned.
+   *
+   * @param symbol the symbol to expand, typically the ID of <start>.
+   * @param dest the vector the terminals are appended to.
+   * @return true if and only if the expansion completed within
+   *         both limits.
+   */
+
+  bool expand(int symbol, vector<string_view>& dest);
+
+  /**
+   * Method: expand
+   * --------------
+   * Identical to the above, except that each span of terminals is written
+   * to the specified TextWriter the moment it's produced, so no
+   * list of terminals is ever built.  Output can't be taken back
+   * once it's been written, so a sentence abandoned because it
+   * exceeded one of the limits leaves its beginning in the writer.
+   *
+   * @param symbol the symbol to expand, typically the ID of <start>.
+   * @param writer the TextWriter each span is written to.
+   * @return true if and only if the expansion completed within
+   *         both limits.
+   */
+
+  bool expand(int symbol, TextWriter& writer);
+
+ private:
+  struct frame {
+    const int *curr;  // next symbol of the production to expand
+    const int *end;
+  };
+
+  const Grammar& grammar;
+  RandomGenerator& random;
+  int maxDepth;
+  int maxTokens;
+  vector<frame> stack;
+
+  template <typename Sink>
+  bool expandInto(int symbol, Sink& sink);
+};
+
+#endif // ! __expander__
@@ -0,0 +1,162 @@
+/**
+ * File: grammar.cc
+ * ----------------
+ * Provides the implementation of readGrammar and of the
+ * Grammar class, which flattens a map<string, Definition>
+ * into integer symbol tables.
+ */
+
+#include "grammar.h"
+#include <cassert>
+
+bool readGrammar(ifstream& infile, map<string, Definition>& grammar)
+{
+  while (true) {
+    string uselessText;
+    getline(infile, uselessText, '{');
+    if (infile.eof()) return true;  // true? we encountered EOF before we saw a '{': no more productions!
+    infile.putback('{');
+    Definition def(infile);
+    if (infile.fail()) return false;
+    grammar[def.getNonterminal()] = def;
+  }
+}
+
+/**
+ * Function: internSymbol
+ * ----------------------
+ * Returns the ID already associated with the specified text,
+ * or appends the text to the table and associates it with
+ * the next available ID.  Only used while compiling.
+ */
+
+template <typename Table>
+static int internSymbol(const string& text, map<string, int>& ids, Table& table)
+{
+  map<string, int>::iterator found = ids.find(text);
+  if (found != ids.end()) return found->second;
+  int id = table.size();
+  ids[text] = id;
+  table.add(text);
+  return id;
+}
+
+/**
+ * Constructor: Grammar
+ * --------------------
+ * Every defined nonterminal is numbered first, in map order, so
+ * that their productions can be laid out contiguously.  Symbols
+ * are then interned as the productions are walked; nonterminals
+ * that are used but never defined end up after all of the defined
+ * ones with empty production ranges.  A token is a nonterminal
+ * exactly when it starts with '<', which is the same rule the
+ * original string-based expansion used.  Terminals are collected
+ * until the next nonterminal or the end of the production and then
+ * interned as one span, so identical runs share a span.  Weighted
+ * definitions get the same alias table the Definition itself built.
+ */
+
+Grammar::Grammar(const map<string, Definition>& definitions)
+{
+  map<string, int> nonterminalIDs;
+  map<string, int> spanIDs;
+  for (map<string, Definition>::const_iterator curr = definitions.begin(); curr != definitions.end(); ++curr)
+    internSymbol(curr->first, nonterminalIDs, nonterminals);
+
+  productionStarts.push_back(0);
+  for (map<string, Definition>::const_iterator curr = definitions.begin(); curr != definitions.end(); ++curr) {
+    definitionStarts.push_back(productionStarts.size() - 1);
+    const Definition& def = curr->second;
+    vector<double> weights;
+    for (Definition::const_iterator prod = def.begin(); prod != def.end(); ++prod) {
+      string span;
+      int numWords = 0;
+      for (Production::const_iterator item = prod->begin(); item != prod->end(); ++item) {
+        if (item->length() && (*item)[0] == '<') {
+          if (numWords > 0) addSpan(span, numWords, spanIDs);
+          symbols.push_back(internSymbol(*item, nonterminalIDs, nonterminals));
+          span.clear();
+          numWords = 0;
+        } else {
+          span += *item;
+          span += ' ';
+          numWords++;
+        }
+      }
+      if (numWords > 0) addSpan(span, numWords, spanIDs);
+      productionStarts.push_back(symbols.size());
+      weights.push_back(prod->getWeight());
+    }
+
+    vector<uint32_t> thresholds(weights.size(), 0);
+    vector<int> aliases(weights.size(), -1);
+    if (def.isWeighted()) buildAliasTable(weights, thresholds, aliases);
+    productionThresholds.insert(productionThresholds.end(), thresholds.begin(), thresholds.end());
+    productionAliases.insert(productionAliases.end(), aliases.begin(), aliases.end());
+  }
+
+  // undefined nonterminals (and the sentinel) all start at the very end
+  while ((int) definitionStarts.size() <= nonterminals.size())
+    definitionStarts.push_back(productionStarts.size() - 1);
+}
+
+/**
+ * Method: addSpan
+ * ---------------
+ * Appends the symbol for the specified pre-rendered run of
+ * terminals, interning the run first if it's new.
+ */
+
+void Grammar::addSpan(const string& span, int numWords, map<string, int>& spanIDs)
+{
+  int id = internSymbol(span, spanIDs, spans);
+  if (id == (int) spanWordCounts.size()) spanWordCounts.push_back(numWords);
+  symbols.push_back(~id);
+}
+
+int Grammar::findNonterminal(const string& name) const
+{
+  for (int i = 0; i < nonterminals.size(); i++)
+    if (nonterminals.get(i) == name) return i;
+  return -1;
+}
+
+/**
+ * Method: getRandomProduction
+ * ---------------------------
+ * Mirrors Definition::getRandomProduction, except that the
+ * chosen production is identified by index instead of by reference,
+ * and the caller supplies the generator.  Unweighted definitions
+ * take a single uniform draw, exactly as they always have.
+ */
+
+int Grammar::getRandomProduction(int nonterminal, RandomGenerator& random) const
+{
+  int first = definitionStarts[nonterminal];
+  int last = definitionStarts[nonterminal + 1] - 1;
+  assert(first <= last);  // make sure that the nonterminal is defined
+  if (productionAliases[first] < 0) return random.getRandomInteger(first, last);
+  return first + random.getWeightedInteger(&productionThresholds[first], &productionAliases[first],
+                                           last - first + 1);
+}
+
+/**
+ * Method: expand
+ * --------------
+ * Recursive, depth-first expansion.  The chosen production
+ * is referenced by index and traversed in place, and spans are
+ * split back into words (see splitSpan) as they're reached.
+ */
+
+void Grammar::expand(int symbol, vector<string_view>& dest, RandomGenerator& random) const
+{
+  if (!isNonterminal(symbol)) {
+    splitSpan(spans.get(getSpanIndex(symbol)), dest);
+    return;
+  }
+
+  int chosenProduction = getRandomProduction(symbol, random);
+  const int *end = productionEnd(chosenProduction);
+  for (const int *curr = productionBegin(chosenProduction); curr != end; ++curr)
+    expand(*curr, dest, random);
+}
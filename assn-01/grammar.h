@@ -0,0 +1,226 @@
+#ifndef __grammar__
+#define __grammar__
+
+/**
+ * File: grammar.h
+ * ---------------
+ * Defines the Grammar class, which is a compiled, read-only
+ * representation of a full CFG.  The map<string, Definition>
+ * built up by readGrammar is convenient to construct, but every
+ * expansion through it hashes and compares strings.  A Grammar
+ * interns every nonterminal and terminal into an integer symbol
+ * ID and lays all of the productions out in flat arrays, so
+ * that expanding a nonterminal is nothing more than indexing.
+ *
+ * Terminals aren't interned one by one.  Each maximal run of
+ * terminals within a production--often the entire production--is
+ * joined into a single span and pre-rendered exactly as it's
+ * printed, every word followed by one space ("a dark and stormy "),
+ * so a whole run can be emitted with a single copy.
+ *
+ * Symbols are encoded as plain ints: nonterminals are numbered
+ * 0, 1, 2, ... and spans are stored as the bitwise complement
+ * of their index into the span table, so every span symbol
+ * is negative.
+ */
+
+#include "definition.h"
+#include "random.h"
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <string_view>
+using namespace std;
+
+/**
+ * Function: readGrammar
+ * ---------------------
+ * Takes a reference to a legitimate infile (one that's been set up
+ * to layer over a file) and populates the grammar map with the
+ * collection of definitions that are spelled out in the referenced
+ * file.  The function is written under the assumption that the
+ * referenced data file is really a grammar file that's properly
+ * formatted, with one exception: a production whose weight isn't
+ * a positive number is reported, and the grammar is rejected.
+ *
+ * @param infile a valid reference to a flat text file storing the grammar.
+ * @param grammar a reference to the STL map, which maps nonterminal strings
+ *                to their definitions.
+ * @return false if some definition couldn't be read.
+ */
+
+bool readGrammar(ifstream& infile, map<string, Definition>& grammar);
+
+class Grammar {
+
+ public:
+
+  /**
+   * Constructor: Grammar
+   * --------------------
+   * Compiles the specified collection of Definitions into
+   * the flat, integer-indexed form.  Nonterminals that are
+   * referenced by some production but never defined are
+   * still assigned a symbol ID; they simply have no productions,
+   * and any attempt to expand one asserts.
+   *
+   * @param definitions the map populated by readGrammar.
+   */
+
+  Grammar(const map<string, Definition>& definitions);
+
+  /**
+   * Default Constructor: Grammar
+   * ----------------------------
+   * Constructs an empty Grammar with no symbols at all.  This is
+   * supplied so that a Grammar can be declared and then filled in
+   * by loadGrammar (see grammarsnapshot.h).
+   */
+
+  Grammar() : productionStarts(1, 0), definitionStarts(1, 0) {}
+
+  /**
+   * Static Methods: isNonterminal, getSpanIndex
+   * -------------------------------------------
+   * Classify a symbol and, for spans, recover the
+   * index into the span table.
+   */
+
+  static bool isNonterminal(int symbol) { return symbol >= 0; }
+  static int getSpanIndex(int symbol) { return ~symbol; }
+
+  /**
+   * Static Method: splitSpan
+   * ------------------------
+   * Appends each of the words in the specified span to dest,
+   * as views into the span itself.
+   */
+
+  static void splitSpan(string_view span, vector<string_view>& dest);
+
+  /**
+   * Method: findNonterminal
+   * -----------------------
+   * Returns the symbol ID of the named nonterminal (with the
+   * '<' and '>' on either side), or -1 if no production or
+   * definition ever mentions it.  This is a linear scan and is
+   * meant to be called once, not on the expansion path.
+   */
+
+  int findNonterminal(const string& name) const;
+
+  /**
+   * Method: getRandomProduction
+   * ---------------------------
+   * Chooses one of the specified nonterminal's productions at
+   * random, in proportion to the productions' weights, and returns
+   * its production index.  The nonterminal must have at least one
+   * production.  The
+   * Grammar itself holds no random state, so any number of
+   * threads can share one Grammar as long as each brings its
+   * own RandomGenerator.
+   */
+
+  int getRandomProduction(int nonterminal, RandomGenerator& random) const;
+
+  /**
+   * Method: expand
+   * --------------
+   * Expands the specified symbol all the way down to terminals,
+   * appending each terminal to dest.  Nothing is copied: every
+   * string_view refers directly into the Grammar's span table,
+   * so the views stay valid for as long as the Grammar does.  If the
+   * caller clears and reuses the same dest vector, generating a
+   * sentence performs no heap allocation once its capacity has
+   * grown to fit the longest sentence.
+   *
+   * @param symbol the symbol to expand, typically the ID of <start>.
+   * @param dest the vector the terminals are appended to.
+   * @param random the source of every production choice.
+   */
+
+  void expand(int symbol, vector<string_view>& dest, RandomGenerator& random) const;
+
+  /**
+   * Methods: productionBegin, productionEnd
+   * ---------------------------------------
+   * Return pointers to the first and past-the-end symbols
+   * of the specified production, so a production can be
+   * traversed like a plain C array.
+   */
+
+  const int *productionBegin(int production) const
+    { return symbols.data() + productionStarts[production]; }
+  const int *productionEnd(int production) const
+    { return symbols.data() + productionStarts[production + 1]; }
+
+  /**
+   * Methods: getSpan, getSpanWordCount, getNonterminal
+   * --------------------------------------------------
+   * Return the pre-rendered text of a span (by span index) and
+   * the number of words in it, or the text of a nonterminal (by
+   * symbol ID).
+   */
+
+  string_view getSpan(int index) const { return spans.get(index); }
+  int getSpanWordCount(int index) const { return spanWordCounts[index]; }
+  string_view getNonterminal(int symbol) const { return nonterminals.get(symbol); }
+
+  int getNumSpans() const { return spans.size(); }
+  int getNumNonterminals() const { return nonterminals.size(); }
+  int getNumProductions() const { return productionStarts.size() - 1; }
+
+ private:
+
+  /**
+   * Stores a table of strings as one block of characters plus
+   * an array of offsets, rather than as a vector<string>, so that
+   * the whole table is two flat arrays that can be written to and
+   * read from a snapshot file as is.
+   */
+
+  struct stringTable {
+    string text;              // every string, back to back
+    vector<int> starts;       // string i occupies [starts[i], starts[i + 1])
+
+    stringTable() : starts(1, 0) {}
+    int size() const { return starts.size() - 1; }
+    string_view get(int i) const
+      { return string_view(text.data() + starts[i], starts[i + 1] - starts[i]); }
+    void add(const string& str) { text += str; starts.push_back(text.size()); }
+  };
+
+  friend class GrammarSnapshot;
+
+  void addSpan(const string& span, int numWords, map<string, int>& spanIDs);
+
+  stringTable spans;
+  vector<int> spanWordCounts;     // parallel to spans
+  stringTable nonterminals;
+  vector<int> symbols;            // every production's symbols, back to back
+  vector<int> productionStarts;   // production p occupies [productionStarts[p], productionStarts[p + 1])
+  vector<int> definitionStarts;   // nonterminal n owns productions [definitionStarts[n], definitionStarts[n + 1])
+
+  // alias tables for weighted definitions, indexed by production, with aliases
+  // relative to the definition's first production; unweighted definitions have -1 aliases
+  vector<uint32_t> productionThresholds;
+  vector<int> productionAliases;
+};
+
+/**
+ * Every word in a span is followed by exactly one space,
+ * so splitting one is a simple scan.
+ */
+
+inline void Grammar::splitSpan(string_view span, vector<string_view>& dest)
+{
+  size_t wordStart = 0;
+  for (size_t i = 0; i < span.size(); i++) {
+    if (span[i] != ' ') continue;
+    dest.push_back(span.substr(wordStart, i - wordStart));
+    wordStart = i + 1;
+  }
+}
+
+#endif // ! __grammar__
@@ -0,0 +1,331 @@
+/**
+ * File: grammarsnapshot.cc
+ * ------------------------
+ * Implements grammar snapshots.  A snapshot file is laid out as
+ *
+ *     snapshotHeader
+ *     section: symbols
+ *     section: productionStarts
+ *     section: definitionStarts
+ *     section: spans.starts
+ *     section: spans.text
+ *     section: spanWordCounts
+ *     section: nonterminals.starts
+ *     section: nonterminals.text
+ *     section: productionThresholds
+ *     section: productionAliases
+ *
+ * where every section is a 4-byte element count followed by the
+ * elements themselves, padded with '\0's out to a multiple of four
+ * bytes so that the next section's ints are aligned.  Everything is
+ * stored in the machine's native byte order; a snapshot is a cache,
+ * not an interchange format.
+ */
+
+#include "grammarsnapshot.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+using namespace std;
+
+static const char kSnapshotMagic[8] = { 'R', 'S', 'G', 'S', 'N', 'A', 'P', '\0' };
+static const uint32_t kSnapshotVersion = 4;
+static const char *const kSnapshotSuffix = ".cache";
+
+struct snapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;    // catches snapshots written by a build with a different layout
+  GrammarSnapshot::sourceStamp source;
+};
+
+bool loadGrammar(const string& grammarFileName, Grammar& grammar, bool useSnapshot)
+{
+  string snapshotName = grammarFileName + kSnapshotSuffix;
+  if (useSnapshot && GrammarSnapshot::read(snapshotName, grammarFileName, grammar)) return true;
+
+  // stamp before parsing, so an edit made mid-parse makes the snapshot stale rather than wrong
+  GrammarSnapshot::sourceStamp stamp;
+  bool stamped = useSnapshot && GrammarSnapshot::stampSource(grammarFileName, stamp, true);
+
+  ifstream grammarFile(grammarFileName.c_str());
+  if (grammarFile.fail()) return false;
+  map<string, Definition> definitions;
+  if (!readGrammar(grammarFile, definitions)) return false;
+  grammar = Grammar(definitions);
+
+  if (stamped) GrammarSnapshot::write(snapshotName, stamp, grammar);
+  return true;
+}
+
+/**
+ * The same bare-bones stat/open/mmap sequence the imdb class
+ * uses to make a file look like an array of bytes in memory, except
+ * that every failure is reported.  Empty files can't be mapped, so
+ * they're represented by a NULL map of size 0.
+ */
+
+struct fileMap {
+  int fd;
+  size_t size;
+  const char *bytes;
+};
+
+static bool acquireFileMap(const string& fileName, fileMap& map)
+{
+  map.fd = open(fileName.c_str(), O_RDONLY);
+  map.bytes = NULL;
+  map.size = 0;
+  if (map.fd == -1) return false;
+
+  struct stat stats;
+  if (fstat(map.fd, &stats) == -1) {
+    close(map.fd);
+    return false;
+  }
+
+  map.size = stats.st_size;
+  if (map.size == 0) return true;
+  void *bytes = mmap(0, map.size, PROT_READ, MAP_SHARED, map.fd, 0);
+  if (bytes == MAP_FAILED) {
+    close(map.fd);
+    return false;
+  }
+
+  map.bytes = (const char *) bytes;
+  return true;
+}
+
+static void releaseFileMap(fileMap& map)
+{
+  if (map.bytes != NULL) munmap((void *) map.bytes, map.size);
+  close(map.fd);
+}
+
+/**
+ * Function: hashBytes
+ * -------------------
+ * 64-bit FNV-1a.  It's not cryptographic, but it doesn't need to be:
+ * it's only there to notice that a grammar file has been edited.
+ */
+
+static uint64_t hashBytes(const char *bytes, size_t size)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= (unsigned char) bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool GrammarSnapshot::stampSource(const string& fileName, sourceStamp& stamp, bool computeHash)
+{
+  struct stat stats;
+  if (stat(fileName.c_str(), &stats) == -1) return false;
+  memset(&stamp, 0, sizeof(stamp));
+  stamp.size = stats.st_size;
+  stamp.modifiedSeconds = stats.st_mtim.tv_sec;
+  stamp.modifiedNanoseconds = stats.st_mtim.tv_nsec;
+  if (!computeHash) return true;
+
+  fileMap source;
+  if (!acquireFileMap(fileName, source)) return false;
+  stamp.hash = hashBytes(source.bytes, source.size);
+  stamp.size = source.size;
+  releaseFileMap(source);
+  return true;
+}
+
+/**
+ * Function: appendSection
+ * -----------------------
+ * Build up the image of a snapshot in memory, one section at a time.
+ */
+
+static void appendSection(string& image, const void *elements, uint32_t count, size_t elementSize)
+{
+  image.append((const char *) &count, sizeof(count));
+  image.append((const char *) elements, count * elementSize);
+  while (image.size() % sizeof(uint32_t) != 0) image += '\0';
+}
+
+template <typename Element>
+static void appendSection(string& image, const vector<Element>& elements)
+{
+  appendSection(image, elements.data(), elements.size(), sizeof(Element));
+}
+
+static void appendSection(string& image, const string& text)
+{
+  appendSection(image, text.data(), text.size(), sizeof(char));
+}
+
+bool GrammarSnapshot::write(const string& snapshotName, const sourceStamp& stamp, const Grammar& grammar)
+{
+  snapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+  header.version = kSnapshotVersion;
+  header.headerSize = sizeof(header);
+  header.source = stamp;
+
+  string image((const char *) &header, sizeof(header));
+  appendSection(image, grammar.symbols);
+  appendSection(image, grammar.productionStarts);
+  appendSection(image, grammar.definitionStarts);
+  appendSection(image, grammar.spans.starts);
+  appendSection(image, grammar.spans.text);
+  appendSection(image, grammar.spanWordCounts);
+  appendSection(image, grammar.nonterminals.starts);
+  appendSection(image, grammar.nonterminals.text);
+  appendSection(image, grammar.productionThresholds);
+  appendSection(image, grammar.productionAliases);
+
+  string temporaryName = snapshotName + "." + to_string(getpid());
+  FILE *outfile = fopen(temporaryName.c_str(), "wb");
+  if (outfile == NULL) return false;
+  bool written = fwrite(image.data(), 1, image.size(), outfile) == image.size();
+  written = (fclose(outfile) == 0) && written;
+  if (written && rename(temporaryName.c_str(), snapshotName.c_str()) == 0) return true;
+  remove(temporaryName.c_str());
+  return false;
+}
+
+/**
+ * Walks the sections of a mapped snapshot in order.  Each
+ * readSection call copies the next section into the supplied
+ * container and fails, leaving the cursor in an unspecified state,
+ * if the section would run past the end of the file.
+ */
+
+struct sectionCursor {
+  const char *curr;
+  const char *end;
+};
+
+static const char *takeSection(sectionCursor& cursor, size_t elementSize, uint32_t& count)
+{
+  if (cursor.end - cursor.curr < (ptrdiff_t) sizeof(count)) return NULL;
+  memcpy(&count, cursor.curr, sizeof(count));
+  const char *elements = cursor.curr + sizeof(count);
+  size_t length = ((size_t) count * elementSize + sizeof(uint32_t) - 1) / sizeof(uint32_t) * sizeof(uint32_t);
+  if ((size_t) (cursor.end - elements) < length) return NULL;
+  cursor.curr = elements + length;
+  return elements;
+}
+
+template <typename Element>
+static bool readSection(sectionCursor& cursor, vector<Element>& elements)
+{
+  uint32_t count;
+  const char *data = takeSection(cursor, sizeof(Element), count);
+  if (data == NULL) return false;
+  elements.assign((const Element *) data, (const Element *) data + count);
+  return true;
+}
+
+static bool readSection(sectionCursor& cursor, string& text)
+{
+  uint32_t count;
+  const char *data = takeSection(cursor, sizeof(char), count);
+  if (data == NULL) return false;
+  text.assign(data, count);
+  return true;
+}
+
+/**
+ * Function: isAscending
+ * ---------------------
+ * Confirms that an offset array starts at zero, never decreases,
+ * and ends exactly at limit, which is all it takes for every range
+ * it describes to be in bounds.
+ */
+
+static bool isAscending(const vector<int>& starts, int limit)
+{
+  if (starts.empty() || starts[0] != 0 || starts.back() != limit) return false;
+  for (size_t i = 1; i < starts.size(); i++)
+    if (starts[i] < starts[i - 1]) return false;
+  return true;
+}
+
+bool GrammarSnapshot::read(const string& snapshotName, const string& sourceName, Grammar& grammar)
+{
+  fileMap snapshot;
+  if (!acquireFileMap(snapshotName, snapshot)) return false;
+
+  snapshotHeader header;
+  bool valid = snapshot.size >= sizeof(header);
+  if (valid) {
+    memcpy(&header, snapshot.bytes, sizeof(header));
+    valid = memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) == 0 &&
+            header.version == kSnapshotVersion && header.headerSize == sizeof(header);
+  }
+
+  sourceStamp source;
+  if (valid) valid = stampSource(sourceName, source, false) && source.size == header.source.size;
+  if (valid && (source.modifiedSeconds != header.source.modifiedSeconds ||
+                source.modifiedNanoseconds != header.source.modifiedNanoseconds))
+    valid = stampSource(sourceName, source, true) && source.hash == header.source.hash;
+
+  Grammar loaded;
+  if (valid) {
+    sectionCursor cursor = { snapshot.bytes + sizeof(header), snapshot.bytes + snapshot.size };
+    valid = readSection(cursor, loaded.symbols) &&
+            readSection(cursor, loaded.productionStarts) &&
+            readSection(cursor, loaded.definitionStarts) &&
+            readSection(cursor, loaded.spans.starts) &&
+            readSection(cursor, loaded.spans.text) &&
+            readSection(cursor, loaded.spanWordCounts) &&
+            readSection(cursor, loaded.nonterminals.starts) &&
+            readSection(cursor, loaded.nonterminals.text) &&
+            readSection(cursor, loaded.productionThresholds) &&
+            readSection(cursor, loaded.productionAliases) &&
+            cursor.curr == cursor.end;
+  }
+  releaseFileMap(snapshot);
+
+  // a damaged snapshot is discarded, not trusted: check every range and symbol
+  valid = valid &&
+    isAscending(loaded.spans.starts, loaded.spans.text.size()) &&
+    isAscending(loaded.nonterminals.starts, loaded.nonterminals.text.size()) &&
+    isAscending(loaded.productionStarts, loaded.symbols.size()) &&
+    isAscending(loaded.definitionStarts, loaded.getNumProductions()) &&
+    (int) loaded.definitionStarts.size() == loaded.getNumNonterminals() + 1 &&
+    (int) loaded.spanWordCounts.size() == loaded.getNumSpans() &&
+    (int) loaded.productionThresholds.size() == loaded.getNumProductions() &&
+    (int) loaded.productionAliases.size() == loaded.getNumProductions();
+  for (size_t i = 0; valid && i < loaded.symbols.size(); i++) {
+    int symbol = loaded.symbols[i];
+    valid = Grammar::isNonterminal(symbol) ? symbol < loaded.getNumNonterminals()
+                                           : Grammar::getSpanIndex(symbol) < loaded.getNumSpans();
+  }
+
+  // writeSpan trusts each span's word count to match its spaces
+  for (int i = 0; valid && i < loaded.getNumSpans(); i++) {
+    string_view span = loaded.getSpan(i);
+    valid = !span.empty() && span.back() == ' ' &&
+            count(span.begin(), span.end(), ' ') == loaded.spanWordCounts[i];
+  }
+
+  for (int n = 0; valid && n < loaded.getNumNonterminals(); n++) {
+    int first = loaded.definitionStarts[n];
+    int count = loaded.definitionStarts[n + 1] - first;
+    for (int i = 0; valid && i < count; i++) {
+      int alias = loaded.productionAliases[first + i];
+      valid = alias >= -1 && alias < count && (alias < 0) == (loaded.productionAliases[first] < 0);
+    }
+  }
+
+  if (valid) grammar = move(loaded);
+  return valid;
+}
@@ -0,0 +1,106 @@
+#ifndef __grammarsnapshot__
+#define __grammarsnapshot__
+
+/**
+ * File: grammarsnapshot.h
+ * -----------------------
+ * Parsing a .g file token by token is by far the slowest part of
+ * starting rsg up.  A snapshot is a compact binary image of the
+ * compiled Grammar--its string tables and its symbol, production,
+ * and definition arrays--that's written next to the .g file the
+ * first time the grammar is parsed (bionic.g gets bionic.g.cache)
+ * and mapped back into memory on every later run.  Each snapshot
+ * records the size, modification time, and a hash of the source
+ * file it was built from, and it's ignored (and rebuilt) as soon as
+ * the source no longer matches.
+ */
+
+#include "grammar.h"
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+/**
+ * Function: loadGrammar
+ * ---------------------
+ * Populates grammar with the compiled form of the specified .g
+ * file, taking it from a valid snapshot when there is one, and
+ * otherwise parsing the file with readGrammar and then (trying to)
+ * save a fresh snapshot for next time.  Failing to write the
+ * snapshot, say because the directory isn't writable, isn't an error.
+ *
+ * @param grammarFileName the path to the .g file.
+ * @param grammar the Grammar to be replaced by the loaded one.
+ * @param useSnapshot false to parse the .g file no matter what and
+ *                    leave any snapshot alone.
+ * @return true if and only if the grammar could be loaded, which
+ *         fails if the .g file can't be opened or readGrammar
+ *         rejects it.
+ */
+
+bool loadGrammar(const string& grammarFileName, Grammar& grammar, bool useSnapshot = true);
+
+/**
+ * Class: GrammarSnapshot
+ * ----------------------
+ * Knows how to write a Grammar out as a snapshot and how to read
+ * one back in.  It's a friend of Grammar, and that's really its only
+ * reason to exist as a class rather than as a pair of functions.
+ */
+
+class GrammarSnapshot {
+
+ public:
+
+  /**
+   * Identifies the version of a source file a snapshot
+   * was built from.
+   */
+
+  struct sourceStamp {
+    int64_t size;
+    int64_t modifiedSeconds;
+    int64_t modifiedNanoseconds;
+    uint64_t hash;             // FNV-1a over the file's bytes
+  };
+
+  /**
+   * Static Method: stampSource
+   * --------------------------
+   * Fills in stamp for the specified source file.  The hash is
+   * only computed if computeHash is true, since it requires
+   * reading the whole file.
+   *
+   * @return true if and only if the file exists and could be read.
+   */
+
+  static bool stampSource(const string& fileName, sourceStamp& stamp, bool computeHash);
+
+  /**
+   * Static Method: read
+   * -------------------
+   * Maps the specified snapshot into memory and, provided it was
+   * built from the source file described by source, copies its
+   * arrays into grammar.  If the size and modification time match
+   * the snapshot is trusted outright; otherwise the source is hashed,
+   * so a file that was merely touched doesn't force a rebuild.
+   *
+   * @return true if and only if grammar was populated.
+   */
+
+  static bool read(const string& snapshotName, const string& sourceName, Grammar& grammar);
+
+  /**
+   * Static Method: write
+   * --------------------
+   * Writes grammar out as a snapshot of the source described by
+   * stamp.  The snapshot is written to a temporary file that's then
+   * renamed into place, so concurrent readers never see half of one.
+   *
+   * @return true if and only if the snapshot was written.
+   */
+
+  static bool write(const string& snapshotName, const sourceStamp& stamp, const Grammar& grammar);
+};
+
+#endif // ! __grammarsnapshot__
@@ -8,6 +8,30 @@
  */
 
 #include "production.h"
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <iostream>
+
+/**
+ * Function: getLineNumber
+ * -----------------------
+ * Counts the newlines ahead of infile's current position to
+ * find the number of the line that was just read.  Only used
+ * to report errors, so rereading the file doesn't matter.
+ */
+
+static long getLineNumber(ifstream& infile)
+{
+  streampos position = infile.tellg();
+  if (position == streampos(-1)) return 0;
+  infile.seekg(0);
+  long numLines = 0;
+  for (streamoff i = 0; i < position; i++)
+    if (infile.get() == '\n') numLines++;
+  infile.seekg(position);
+  return numLines;
+}
 
 /**
  * Constructor Implementation: Production
@@ -21,13 +45,15 @@
  * to their own productions) are delimited by '<' and '>' and 
  * that no whitespace appears in between '<' and '>'.  The implementation
  * will also read the whitespace and the '\n' appearing after the 
- * semicolon and discard it.
+ * semicolon and discard it, after checking whether it spells out
+ * a weight.  Anything else on that line is reported, along with
+ * the line's number, and leaves infile's failbit set.
  *
  * You are more than welcome to update this implementation to do
  * something else if you'd like to.
  */
 
-Production::Production(ifstream& infile)  // phrases is constructed, size is 0
+Production::Production(ifstream& infile) : weight(1.0)  // phrases is constructed, size is 0
 {
   while (true) {
     string token;
@@ -38,5 +64,18 @@ Production::Production(ifstream& infile)  // phrases is constructed, size is 0
   
   string uselessText;
   getline(infile, uselessText); // read everything else as if it's important
-  // oh, no it's not.. it's useless.. but we're glad it's been pulled from the stream..
+  // oh, no it's not.. it's useless.. unless it's a weight
+  char *end;
+  double value = strtod(uselessText.c_str(), &end);
+  while (isspace(*end)) end++;
+  if (end != uselessText.c_str() && *end == '\0' && value > 0 && value < HUGE_VAL) {
+    weight = value;
+    return;
+  }
+
+  size_t first = uselessText.find_first_not_of(" \t\r");
+  if (first == string::npos) return;  // no weight at all
+  cerr << "Line " << getLineNumber(infile) << ": \"" << uselessText.substr(first)
+       << "\" isn't a positive weight." << endl;
+  infile.setstate(ios::failbit);
 }
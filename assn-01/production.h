@@ -44,7 +44,7 @@ class Production {
    * have a default constructor.
    */
   
-  Production() {}
+  Production() : weight(1.0) {}
   
   /**
    * ifstream Constructor: Production
@@ -54,7 +54,15 @@ class Production {
    * positions at the start of a line that houses a production.
    * Leading whitespace is discarded, the series of terminals and
    * non-terminals are read in until a semicolon is consumed, and
-   * the the rest of the data is discarded.
+   * the the rest of the data is discarded--unless the rest of the
+   * line is a positive number, in which case it's taken to be the
+   * production's weight:
+   *
+   *     <dubious-excuse> , and then <plea> ;  3
+   *
+   * Productions without a weight have a weight of 1.  Text after
+   * the semicolon that isn't a positive number (0, -2, heavy) is
+   * reported on cerr and sets infile's failbit.
    */
   
   Production(ifstream& infile);
@@ -66,7 +74,16 @@ class Production {
    * a copy of the provided vector.
    */
   
-  Production(const vector<string>& words) : phrases(words) {}
+  Production(const vector<string>& words) : phrases(words), weight(1.0) {}
+
+  /**
+   * Method: getWeight
+   * -----------------
+   * Returns the Production's weight, which is relative to the
+   * weights of the other Productions in the same Definition.
+   */
+
+  double getWeight() const { return weight; }
   
   /**
    * Iterators: begin, end
@@ -93,6 +110,7 @@ class Production {
   
  private:
   vector<string> phrases;
+  double weight;
 };
 
 #endif
@@ -1,13 +1,10 @@
 #include <time.h>
-#include <stdlib.h>
-#include <limits.h>
-#include <cassert> // for assert macro
 #include "random.h"
 
 /**
  * Constructor: RandomGenerator
  * ----------------------------
- * Initializes a RandomGenerator number generator, using 
+ * Initializes a RandomGenerator number generator, using
  * informtaion based on the current time as the seed.
  * This is the traditional way to set the stage for a computer
  * program to use random numbers.
@@ -15,23 +12,64 @@
 
 RandomGenerator::RandomGenerator()
 {
-  srand(time(NULL));
+  *this = RandomGenerator(time(NULL));
 }
 
 /**
- * Method: getRandomInteger
- * ------------------------
- * Returns a seemingly random number between
- * the specified low and high, inclusive.  Based
- * on Eric Roberts' implementation from his
- * CS106A text.
+ * Constructor: RandomGenerator
+ * ----------------------------
+ * Initializes a RandomGenerator with an explicit seed, following
+ * the reference PCG seeding procedure: the stream picks the (odd)
+ * increment, and the seed is stirred into the state by stepping the
+ * generator on either side of adding it in.
  */
 
-int RandomGenerator::getRandomInteger(int low, int high)
+RandomGenerator::RandomGenerator(uint64_t seed, uint64_t stream)
 {
-  assert(low <= high);
-  double percent = (rand() / (static_cast<double>(RAND_MAX) + 1));
-  assert(percent >= 0.0 && percent < 1.0); 
-  int offset = static_cast<int>(percent * (high - low + 1));
-  return low + offset;
+  state = 0;
+  increment = (stream << 1) | 1;
+  getRandomBits();
+  state += seed;
+  getRandomBits();
+}
+
+/**
+ * Function: buildAliasTable
+ * -------------------------
+ * Scales the weights so they average 1, then repeatedly pairs an
+ * underfull column with an overfull one: the underfull column keeps
+ * its own probability and hands the rest of its slot to the overfull
+ * one, which is then reclassified.  Whatever's left over at the end
+ * is (up to rounding) exactly full.
+ */
+
+void buildAliasTable(const vector<double>& weights, vector<uint32_t>& thresholds, vector<int>& aliases)
+{
+  int count = weights.size();
+  double total = 0;
+  for (int i = 0; i < count; i++) total += weights[i];
+
+  vector<double> scaled(count);
+  vector<int> small, large;
+  for (int i = 0; i < count; i++) {
+    scaled[i] = weights[i] * count / total;
+    if (scaled[i] < 1.0) small.push_back(i);
+    else large.push_back(i);
+  }
+
+  thresholds.assign(count, UINT32_MAX);
+  aliases.resize(count);
+  for (int i = 0; i < count; i++) aliases[i] = i;
+
+  while (!small.empty() && !large.empty()) {
+    int under = small.back();
+    small.pop_back();
+    int over = large.back();
+    large.pop_back();
+    thresholds[under] = (uint32_t) (scaled[under] * 4294967296.0);
+    aliases[under] = over;
+    scaled[over] += scaled[under] - 1.0;
+    if (scaled[over] < 1.0) small.push_back(over);
+    else large.push_back(over);
+  }
 }
@@ -6,26 +6,62 @@
  * --------------
  * Provides a random number generator so
  * that pseudo-random numbers can be produced.
+ * Each RandomGenerator is an independent PCG32
+ * generator (permuted congruential generator, 64
+ * bits of state, 32 bits of output per step), so
+ * instances are cheap, reproducible from their seed,
+ * and safe to use from different threads as long as
+ * no one instance is shared between them.
  */
 
+#include <stdint.h>
+#include <cassert>
+#include <vector>
+using namespace std;
+
 class RandomGenerator {
-  
- public: 
-  
+
+ public:
+
   /**
    * Constructor: RandomGenerator
    * ----------------------------
-   * Constructs a new RandomGenerator object.
+   * Constructs a new RandomGenerator object, seeded
+   * from the current time.
    */
-  
+
   RandomGenerator();
 
+  /**
+   * Constructor: RandomGenerator
+   * ----------------------------
+   * Constructs a new RandomGenerator object whose sequence
+   * is entirely determined by the specified seed and stream.
+   * Generators built from the same seed but different streams
+   * produce unrelated sequences, which is the cheap way to hand
+   * each of several workers its own generator.
+   *
+   * @param seed the seed for this generator's sequence.
+   * @param stream selects one of 2^63 independent sequences.
+   */
+
+  RandomGenerator(uint64_t seed, uint64_t stream = 0);
+
+  /**
+   * Method: getRandomBits
+   * ---------------------
+   * Advances the generator and returns the next 32
+   * uniformly distributed bits.
+   */
+
+  uint32_t getRandomBits();
+
   /**
    * Method: getRandomInteger
    * ------------------------
    * Generates a seemingly random integer between the two specified
    * integers, inclusive.  All numbers in the range [low, high] are
-   * equally likely outcomes.  If low and high are the same, then 
+   * equally likely outcomes.  If low and high are the same, then
    * that number is guaranteed to be returned.  If low is greater than
    * high, then getRandomInteger asserts and ends the program.
    *
@@ -33,9 +69,91 @@ class RandomGenerator {
    * @param the highest number we'd like to be considered as a return value.
    * @return some number drawn uniformly from the range [low, high].
    */
-  
-  int getRandomInteger(int low, int high);  
+
+  int getRandomInteger(int low, int high);
+
+  /**
+   * Method: getWeightedInteger
+   * --------------------------
+   * Draws an integer from [0, count) with the distribution encoded
+   * by an alias table (see buildAliasTable below) in constant time:
+   * one uniform draw picks a column, and a second decides between
+   * the column itself and its alias.
+   *
+   * @param thresholds the alias table's per-column thresholds.
+   * @param aliases the alias table's per-column aliases.
+   * @param count the number of columns in the table.
+   * @return an integer in [0, count).
+   */
+
+  int getWeightedInteger(const uint32_t *thresholds, const int *aliases, int count);
+
+ private:
+  uint64_t state;
+  uint64_t increment;  // always odd; selects the stream
 };
 
-#endif // ! __random__
+/**
+ * The methods above sit on the expansion hot path--one call
+ * per nonterminal--so they're defined here, where the compiler can
+ * inline them into their callers.
+ */
+
+inline uint32_t RandomGenerator::getRandomBits()
+{
+  uint64_t oldState = state;
+  state = oldState * 6364136223846793005ULL + increment;
+  uint32_t xorShifted = ((oldState >> 18) ^ oldState) >> 27;
+  uint32_t rotation = oldState >> 59;
+  return (xorShifted >> rotation) | (xorShifted << ((-rotation) & 31));
+}
 
+/**
+ * Scales 32 random bits into [0, range) with a single 64-bit
+ * multiply: the high half of bits * range is the result.  That
+ * alone slightly favors some outcomes, so draws whose low half
+ * falls below 2^32 mod range are rejected and redrawn.  The modulo
+ * is only computed in the rare case the low half is small enough to
+ * possibly need it, so the common case has no division at all.
+ */
+
+inline int RandomGenerator::getRandomInteger(int low, int high)
+{
+  assert(low <= high);
+  uint32_t range = (uint32_t) high - (uint32_t) low + 1;
+  if (range == 0) return (int) getRandomBits();  // [INT_MIN, INT_MAX]: every 32-bit pattern
+  uint64_t product = (uint64_t) getRandomBits() * range;
+  uint32_t leftover = (uint32_t) product;
+  if (leftover < range) {
+    uint32_t threshold = -range % range;
+    while (leftover < threshold) {
+      product = (uint64_t) getRandomBits() * range;
+      leftover = (uint32_t) product;
+    }
+  }
+  return low + (int) (product >> 32);
+}
+
+inline int RandomGenerator::getWeightedInteger(const uint32_t *thresholds, const int *aliases, int count)
+{
+  int column = getRandomInteger(0, count - 1);
+  return getRandomBits() < thresholds[column] ? column : aliases[column];
+}
+
+/**
+ * Function: buildAliasTable
+ * -------------------------
+ * Builds a Walker alias table for the specified positive weights
+ * using Vose's method.  Column i is chosen outright with probability
+ * thresholds[i] / 2^32 and otherwise defers to aliases[i].  Columns
+ * that should always keep their draw have themselves as their alias,
+ * so that they're correct whichever way the comparison goes.
+ *
+ * @param weights the relative weight of each outcome.
+ * @param thresholds populated with one threshold per outcome.
+ * @param aliases populated with one alias per outcome.
+ */
+
+void buildAliasTable(const vector<double>& weights, vector<uint32_t>& thresholds, vector<int>& aliases);
+
+#endif // ! __random__
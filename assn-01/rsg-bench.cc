@@ -0,0 +1,235 @@
+/**
+ * File: rsg-bench.cc
+ * ------------------
+ * Measures how quickly sentences can be generated from each
+ * of the grammar files named on the command line, comparing the
+ * original string-based expansion (a map<string, Definition>,
+ * Productions copied by value, a vector<string> of output words)
+ * against the zero-copy Grammar::expand path, the iterative
+ * Expander, and the Expander writing formatted text the way rsg
+ * itself does.  For each grammar it reports how long parsing and
+ * compiling took, how long loadGrammar takes to do both (cold) and
+ * to map the grammar's snapshot back in (warm), and for each path
+ * it reports sentences and tokens per second, heap allocations
+ * per sentence, and the median and 99th percentile time taken by
+ * a single sentence.
+ *
+ * Every path draws from a RandomGenerator seeded with the same
+ * fixed seed (1, unless --seed says otherwise), so two runs of the
+ * benchmark--say, before and after a change to Definition or
+ * Production--generate exactly the same sentences.  Each path
+ * generates kNumSentences sentences or runs for kSecondsPerPath
+ * seconds, whichever comes first.
+ *
+ * Usage: rsg-bench [--seed <n>] <grammar-file> [<grammar-file> ...]
+ */
+
+#include <map>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <new>
+#include <cstdlib>
+#include <cassert>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include "definition.h"
+#include "grammar.h"
+#include "grammarsnapshot.h"
+#include "expander.h"
+#include "textwriter.h"
+using namespace std;
+
+static const int kNumSentences = 20000;
+static const double kSecondsPerPath = 2.0;  // some grammars (math.g) have heavy-tailed sentence lengths
+static const uint64_t kDefaultSeed = 1;
+
+/**
+ * Every heap allocation made by this program passes through
+ * the replacement operator new below, so the number of
+ * allocations performed over some stretch of code is just the
+ * difference between two readings of numAllocations.
+ */
+
+static unsigned long numAllocations = 0;
+
+void *operator new(size_t size)
+{
+  numAllocations++;
+  void *memory = malloc(size == 0 ? 1 : size);
+  if (memory == NULL) throw bad_alloc();
+  return memory;
+}
+
+void operator delete(void *memory) noexcept { free(memory); }
+void operator delete(void *memory, size_t) noexcept { free(memory); }
+
+/**
+ * The expansion routine as rsg originally implemented it, kept
+ * verbatim (modulo const and an explicit, seedable generator) as the
+ * baseline being measured against.
+ */
+
+static void legacyText(map<string, Definition> &grammar, vector<string> &dest, string input,
+                       RandomGenerator &random)
+{
+  if(!input.length() || input[0] != '<')
+  {
+    dest.push_back(input);
+    return;
+  }
+
+  assert(grammar.count(input));
+
+  Production chosenProduction = grammar[input].getRandomProduction(random);
+  for(Production::iterator it = chosenProduction.begin(); it != chosenProduction.end(); it++)
+  {
+    string currentString = *it;
+    legacyText(grammar, dest, currentString, random);
+  }
+}
+
+static double secondsSince(chrono::steady_clock::time_point begin)
+{
+  return chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+}
+
+/**
+ * Function: percentile
+ * --------------------
+ * Returns the specified percentile of the supplied sample,
+ * which is partially reordered in the process.
+ */
+
+static double percentile(vector<double>& sample, double fraction)
+{
+  size_t rank = min(sample.size() - 1, (size_t) (fraction * sample.size()));
+  nth_element(sample.begin(), sample.begin() + rank, sample.end());
+  return sample[rank];
+}
+
+/**
+ * Function: measure
+ * -----------------
+ * Calls generate--which produces one sentence and returns the
+ * number of words in it--until the sentence or time limit is
+ * reached, timing each call individually, and prints one row of
+ * the results table.  The latency sample is allocated up front so
+ * that it doesn't show up in the allocation count.
+ */
+
+template <typename Generate>
+static void measure(const string& label, Generate generate)
+{
+  vector<double> latencies;
+  latencies.reserve(kNumSentences);
+  unsigned long totalWords = 0;
+  unsigned long allocationsBefore = numAllocations;
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  while ((int) latencies.size() < kNumSentences && secondsSince(begin) < kSecondsPerPath) {
+    chrono::steady_clock::time_point sentenceBegin = chrono::steady_clock::now();
+    totalWords += generate();
+    latencies.push_back(secondsSince(sentenceBegin));
+  }
+  double seconds = secondsSince(begin);
+  unsigned long allocations = numAllocations - allocationsBefore;
+
+  int sentences = latencies.size();
+  cout << "    " << left << setw(10) << label << right << fixed
+       << setw(10) << setprecision(0) << sentences / seconds << " sentences/sec"
+       << setw(12) << setprecision(0) << totalWords / seconds << " tokens/sec"
+       << setw(9) << setprecision(2) << (double) allocations / sentences << " allocs/sentence"
+       << setw(9) << setprecision(2) << percentile(latencies, 0.50) * 1e6 << " us p50"
+       << setw(10) << setprecision(2) << percentile(latencies, 0.99) * 1e6 << " us p99" << endl;
+}
+
+static void benchmarkGrammar(const char *fileName, uint64_t seed)
+{
+  ifstream grammarFile(fileName);
+  if (grammarFile.fail()) {
+    cerr << "Failed to open the file named \"" << fileName << "\"." << endl;
+    return;
+  }
+
+  map<string, Definition> definitions;
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  if (!readGrammar(grammarFile, definitions)) {
+    cerr << "Failed to read the grammar in \"" << fileName << "\"." << endl;
+    return;
+  }
+  double parseSeconds = secondsSince(begin);
+  begin = chrono::steady_clock::now();
+  Grammar grammar(definitions);
+  double compileSeconds = secondsSince(begin);
+  int start = grammar.findNonterminal("<start>");
+  cout << fileName << ": parsed in " << fixed << setprecision(3) << parseSeconds * 1e3
+       << " ms, compiled in " << compileSeconds * 1e3 << " ms" << endl;
+
+  // what rsg itself pays at startup: the first loadGrammar call (re)writes the
+  // snapshot, so the timed one after it reads the snapshot if it could be written
+  Grammar loaded;
+  begin = chrono::steady_clock::now();
+  loadGrammar(fileName, loaded, false);
+  double coldSeconds = secondsSince(begin);
+  loadGrammar(fileName, loaded);
+  begin = chrono::steady_clock::now();
+  loadGrammar(fileName, loaded);
+  double warmSeconds = secondsSince(begin);
+  cout << setw(strlen(fileName) + 2) << "" << "loaded cold in " << coldSeconds * 1e3
+       << " ms, from its snapshot in " << warmSeconds * 1e3 << " ms" << endl;
+
+  RandomGenerator legacyRandom(seed);
+  vector<string> words;
+  measure("legacy", [&]() {
+    words.clear();
+    legacyText(definitions, words, "<start>", legacyRandom);
+    return words.size();
+  });
+
+  RandomGenerator zeroCopyRandom(seed);
+  vector<string_view> views;
+  measure("zero-copy", [&]() {
+    views.clear();
+    grammar.expand(start, views, zeroCopyRandom);
+    return views.size();
+  });
+
+  RandomGenerator iterativeRandom(seed);
+  Expander iterative(grammar, iterativeRandom, INT_MAX, INT_MAX);
+  measure("iterative", [&]() {
+    views.clear();
+    iterative.expand(start, views);
+    return views.size();
+  });
+
+  // every word the writer lays out is followed by exactly one space
+  RandomGenerator textRandom(seed);
+  Expander text(grammar, textRandom, INT_MAX, INT_MAX);
+  TextWriter writer;
+  measure("text", [&]() {
+    writer.clear();
+    text.expand(start, writer);
+    return count(writer.getText().begin(), writer.getText().end(), ' ');
+  });
+}
+
+int main(int argc, char *argv[])
+{
+  uint64_t seed = kDefaultSeed;
+  int first = 1;
+  if (argc > 2 && strcmp(argv[1], "--seed") == 0) {
+    seed = strtoull(argv[2], NULL, 10);
+    first = 3;
+  }
+
+  if (first == argc) {
+    cerr << "Usage: rsg-bench [--seed <n>] <grammar-file> [<grammar-file> ...]" << endl;
+    return 1;
+  }
+
+  for (int i = first; i < argc; i++)
+    benchmarkGrammar(argv[i], seed);
+  return 0;
+}
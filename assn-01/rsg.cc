@@ -4,7 +4,9 @@
  * Provides the implementation of the full RSG application, which
  * relies on the services of the built-in string, ifstream, vector,
  * and map classes as well as the custom Production and Definition
- * classes provided with the assignment.
+ * classes provided with the assignment.  The grammar is read into
+ * Definitions and then compiled into a Grammar before any text
+ * is generated.
  */
  
 #include <map>
@@ -12,122 +14,274 @@
 #include <assert.h>
 #include "definition.h"
 #include "production.h"
+#include "grammar.h"
+#include "expander.h"
+#include "batch.h"
+#include "textwriter.h"
+#include "grammarsnapshot.h"
+#include "analysis.h"
+#include "server.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <thread>
 using namespace std;
 
+static const long kMaxThreads = 256;  // beyond this, more threads only cost memory
+
+/**
+ * Bundles everything that can be specified on the command line.
+ * Fields that aren't mentioned keep the defaults parseOptions
+ * installs before it looks at any arguments.
+ */
+
+struct rsgOptions {
+  vector<const char *> grammarFileNames;  // exactly one, unless serving
+  const char *socketPath;  // non-NULL if --serve asks for server mode
+  int maxDepth;
+  int maxTokens;
+  long count;          // 0 unless --count asks for batch mode
+  int threads;
+  bool seeded;         // whether --seed was supplied
+  uint64_t seed;
+  bool useSnapshot;    // false if --no-cache was supplied
+  bool analyze;        // --analyze: print the grammar's analysis instead of any text
+  bool check;          // --check: refuse grammars whose <start> can't always be expanded
+  long maxExpected;    // 0 unless --max-expected caps <start>'s expected length
+};
+
 /**
- * Takes a reference to a legitimate infile (one that's been set up
- * to layer over a file) and populates the grammar map with the
- * collection of definitions that are spelled out in the referenced
- * file.  The function is written under the assumption that the
- * referenced data file is really a grammar file that's properly
- * formatted.  You may assume that all grammars are in fact properly
- * formatted.
+ * Walks the command line and populates the supplied rsgOptions.
+ * Every option other than the --no-cache, --analyze, and --check
+ * flags is of the form --name <value>, and the one argument that
+ * isn't an option names the grammar file.  --max-expected implies
+ * --check.  In server mode (--serve <socket>) any number of grammar
+ * files may be named.
+ * --threads defaults to the number of cores and is capped at
+ * kMaxThreads.  Values that don't fit in the field they're meant for
+ * are refused rather than truncated.
  *
- * @param infile a valid reference to a flat text file storing the grammar.
- * @param grammar a reference to the STL map, which maps nonterminal strings
- *                to their definitions.
+ * @return true if and only if the command line made sense.
  */
 
-static void readGrammar(ifstream& infile, map<string, Definition>& grammar)
+static bool parseOptions(int argc, char *argv[], rsgOptions& options)
 {
-  while (true) {
-    string uselessText;
-    getline(infile, uselessText, '{');
-    if (infile.eof()) return;  // true? we encountered EOF before we saw a '{': no more productions!
-    infile.putback('{');
-    Definition def(infile);
-    grammar[def.getNonterminal()] = def;
+  options.grammarFileNames.clear();
+  options.socketPath = NULL;
+  options.maxDepth = Expander::kDefaultMaxDepth;
+  options.maxTokens = Expander::kDefaultMaxTokens;
+  options.count = 0;
+  options.threads = max(1u, thread::hardware_concurrency());
+  options.seeded = false;
+  options.useSnapshot = true;
+  options.analyze = false;
+  options.check = false;
+  options.maxExpected = 0;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg.compare(0, 2, "--") != 0) {
+      options.grammarFileNames.push_back(argv[i]);
+      continue;
+    }
+
+    if (arg == "--no-cache") {
+      options.useSnapshot = false;
+      continue;
+    }
+
+    if (arg == "--analyze" || arg == "--check") {
+      (arg == "--analyze" ? options.analyze : options.check) = true;
+      continue;
+    }
+
+    if (i + 1 == argc) return false;
+    if (arg == "--serve") {
+      options.socketPath = argv[++i];
+      continue;
+    }
+
+    char *end;
+    errno = 0;
+    long value = strtol(argv[++i], &end, 10);
+    if (*end != '\0' || value < 0 || errno == ERANGE) return false;
+    if (arg == "--seed") {
+      options.seeded = true;
+      options.seed = value;
+      continue;
+    }
+
+    if (value == 0) return false;
+    if (value > INT_MAX && arg != "--count" && arg != "--max-expected") return false;
+    if (arg == "--max-depth") options.maxDepth = value;
+    else if (arg == "--max-tokens") options.maxTokens = value;
+    else if (arg == "--count") options.count = value;
+    else if (arg == "--threads") options.threads = min(value, (long) kMaxThreads);
+    else if (arg == "--max-expected") options.check = true, options.maxExpected = value;
+    else return false;
   }
+
+  if (options.socketPath != NULL) return !options.grammarFileNames.empty();
+  return options.grammarFileNames.size() == 1;
 }
 
 /**
- * recursive function to make random text based on the given grammar and the given terminal/nonterminal
-*/
-void recursiveText(map<string, Definition> &grammar, vector<string> &dest, string input)
+ * Reads the grammar into a map<string, Definition>, analyzes it, and
+ * either prints the analysis (--analyze) or makes sure the grammar
+ * is safe to expand (--check, --max-expected) before compiling it.
+ * The analysis needs the Definitions themselves, so the snapshot is
+ * neither read nor written.
+ *
+ * @return the status rsg should exit with if it's not 0: 2 if the
+ *         grammar file can't be opened or read, and 4 if the grammar is rejected
+ *         (or, for --analyze, if it would have been).
+ */
+
+static int analyzeAndLoadGrammar(const rsgOptions& options, Grammar& grammar)
 {
-  //check if the given input is a nonterminal
-  if(!input.length() || input[0] != '<')
-  { //push it in the vector and return if it is a terminal
-    dest.push_back(input);
-    return;
+  const char *grammarFileName = options.grammarFileNames[0];
+  ifstream grammarFile(grammarFileName);
+  if (grammarFile.fail()) {
+    cerr << "Failed to open the file named \"" << grammarFileName << "\".  Check to ensure the file exists. " << endl;
+    return 2;
   }
 
-  //make sure that the nonterminal is valid
-  assert(grammar.count(input));
-  
-  //choose a random production and call the function recursively to generate text from it
-  Production chosenProduction = grammar[input].getRandomProduction();
-  for(Production::iterator it = chosenProduction.begin(); it != chosenProduction.end(); it++)
-  {
-    string currentString = *it;
-    recursiveText(grammar, dest, currentString);
+  map<string, Definition> definitions;
+  if (!readGrammar(grammarFile, definitions)) {
+    cerr << "Failed to read the grammar in \"" << grammarFileName << "\"." << endl;
+    return 2;
+  }
+  grammarReport report;
+  analyzeGrammar(definitions, "<start>", report);
+  if (options.analyze) {
+    printReport(report, cout);
+    return report.fatal ? 4 : 0;
   }
-}
 
-void printText(vector<string> &words, int lineLengthLimit)
-{
-  int currentLineLength = 0;
-  //print words one by one
-  for(int i = 0, size = words.size(); i < size; i++)
-  {
-    currentLineLength += words[i].length();
-    //restrict length of each line
-    if(currentLineLength > lineLengthLimit)
-    {
-      cout << endl;
-      currentLineLength = 0;
-    }
-    //print current word
-    cout << words[i] << " ";
+  if (report.fatal) {
+    cerr << "The grammar can't always be expanded: <start> can reach a nonterminal that's"
+         << " undefined or never expands to text.  Run rsg --analyze for details." << endl;
+    return 4;
   }
-  //print a new line at the end
-  cout << endl;
+
+  double expected = report.expectedLengths["<start>"];
+  if (options.maxExpected > 0 && expected > options.maxExpected) {
+    cerr << "The grammar's expected expansion length (";
+    if (expected == HUGE_VAL) cerr << "unbounded"; else cerr << expected << " words";
+    cerr << ") exceeds --max-expected " << options.maxExpected << "." << endl;
+    return 4;
+  }
+
+  grammar = Grammar(definitions);
+  return 0;
 }
 
 /**
  * Performs the rudimentary error checking needed to confirm that
  * the client provided a grammar file.  It then continues to
- * open the file, read the grammar into a map<string, Definition>,
- * and then print out the total number of Definitions that were read
- * in.  You're to update and decompose the main function to print
- * three randomly generated sentences, as illustrated by the sample
- * application.
+ * load the compiled Grammar--from the grammar's snapshot if it has a
+ * current one, and by reading the grammar into a map<string, Definition>
+ * and compiling that if not--and print three randomly generated
+ * sentences.  Expansion is iterative, and a sentence that grows
+ * deeper than --max-depth nonterminals or longer than --max-tokens
+ * terminals ends the program with an error rather than exhausting
+ * memory.
+ *
+ * --analyze prints a static analysis of the grammar instead of any
+ * text, and --check and --max-expected reject grammars the analysis
+ * finds pathological before anything is generated.
+ *
+ * If --count is supplied, rsg instead runs in batch mode and prints
+ * that many sentences (without the "Version #" banners), spread
+ * over --threads worker threads.  Sentences that grow past the limits
+ * are drawn again (and counted on cerr), so exactly that many are
+ * printed unless one keeps growing past them.
+ * Supplying --seed makes either mode's output reproducible.
+ *
+ * If --serve is supplied, rsg loads every grammar named on the
+ * command line and answers requests for text from them on the
+ * specified Unix domain socket until it's killed (see server.h),
+ * using --threads workers.
  *
  * @param argc the number of tokens making up the command that invoked
- *             the RSG executable.  There must be at least two arguments,
- *             and only the first two are used.
+ *             the RSG executable.
  * @param argv the sequence of tokens making up the command, where each
  *             token is represented as a '\0'-terminated C string.
  */
 
 int main(int argc, char *argv[])
 {
-  if (argc == 1) {
+  rsgOptions options;
+  if (!parseOptions(argc, argv, options)) {
     cerr << "You need to specify the name of a grammar file." << endl;
-    cerr << "Usage: rsg <path to grammar text file>" << endl;
+    cerr << "Usage: rsg [--count <n> [--threads <n>]] [--seed <n>]" << endl;
+    cerr << "           [--max-depth <n>] [--max-tokens <n>] [--no-cache]" << endl;
+    cerr << "           [--analyze | --check | --max-expected <n>] <path to grammar text file>" << endl;
+    cerr << "   or: rsg --serve <socket path> [--threads <n>] [--max-depth <n>] [--max-tokens <n>]" << endl;
+    cerr << "           [--no-cache] <path to grammar text file> ..." << endl;
     return 1; // non-zero return value means something bad happened 
   }
-  
-  ifstream grammarFile(argv[1]);
-  if (grammarFile.fail()) {
-    cerr << "Failed to open the file named \"" << argv[1] << "\".  Check to ensure the file exists. " << endl;
+
+  if (options.socketPath != NULL) {
+    serverOptions server = { options.socketPath, options.threads, options.maxDepth, options.maxTokens,
+                             options.useSnapshot };
+    serveGrammars(options.grammarFileNames, server);
+    return 5;  // serveGrammars only returns if the server couldn't be started
+  }
+
+  const char *grammarFileName = options.grammarFileNames[0];
+  Grammar grammar;
+  if (options.analyze || options.check) {
+    int status = analyzeAndLoadGrammar(options, grammar);
+    if (status != 0 || options.analyze) return status;
+  } else if (!loadGrammar(grammarFileName, grammar, options.useSnapshot)) {
+    cerr << "Failed to load the file named \"" << grammarFileName << "\".  Check to ensure the file exists"
+         << " and holds a well-formed grammar." << endl;
     return 2; // each bad thing has its own bad return value
   }
   
   // things are looking good...
-  map<string, Definition> grammar;
-  readGrammar(grammarFile, grammar);
-  // cout << "The grammar file called \"" << argv[1] << "\" contains "
-  //      << grammar.size() << " definitions." << endl;
+  int start = grammar.findNonterminal("<start>");
+  assert(start != -1);
   
-  vector<string> words;
+  uint64_t seed = options.seeded ? options.seed : time(NULL);
+  TextWriter out(STDOUT_FILENO);  // text streams out as it's expanded, flushed in large blocks
+  if (options.count > 0) {
+    batchOptions batch = { options.count, options.threads, seed, options.maxDepth, options.maxTokens, 0 };
+    long numRedrawn;
+    batchStatus status = generateBatch(grammar, start, batch, out, numRedrawn);
+    if (status == kBatchTooDeep) {
+      out.flush();
+      cerr << "Some sentence grew past the expansion limits (max depth " << options.maxDepth
+           << ", max tokens " << options.maxTokens << ") " << kMaxRedraws << " times in a row." << endl;
+      return 3;
+    }
+    if (status == kBatchWriteFailed) {
+      cerr << "The output couldn't be written." << endl;
+      return 3;
+    }
+    if (numRedrawn > 0)
+      cerr << "Redrew " << numRedrawn << " sentences that grew past the expansion limits (max depth "
+           << options.maxDepth << ", max tokens " << options.maxTokens << ")." << endl;
+    return 0;
+  }
+
+  RandomGenerator random(seed);
+  Expander expander(grammar, random, options.maxDepth, options.maxTokens);
   for(int i = 1; i <= 3; i++)
   {
-    cout << "Version #" << i << ": ---------------------------" << endl;
-    recursiveText(grammar, words, "<start>");
-    printText(words, 40);
-    cout << endl;
-    words.clear();
+    out.write("Version #" + to_string(i) + ": ---------------------------\n");
+    if (!expander.expand(start, out)) {
+      out.flush();
+      cerr << endl << "Version #" << i << " grew past the expansion limits (max depth "
+           << options.maxDepth << ", max tokens " << options.maxTokens << ")." << endl;
+      return 3;
+    }
+    out.endText();
+    out.write("\n");
   }
   return 0;
 }
@@ -0,0 +1,277 @@
+/**
+ * File: server.cc
+ * ---------------
+ * Implements rsg's server mode.  Every worker thread blocks in
+ * accept on the same listening socket, so the kernel hands each
+ * new connection to exactly one idle worker, and there's no queue
+ * or dispatcher of our own to keep in sync.  Requests are answered
+ * with generateBatch, run on the worker's own thread.
+ */
+
+#include "server.h"
+#include "grammar.h"
+#include "grammarsnapshot.h"
+#include "batch.h"
+#include "textwriter.h"
+#include "random.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <thread>
+#include <sstream>
+#include <iostream>
+using namespace std;
+
+static const size_t kMaxRequestLength = 1024;
+static const long kMaxSentencesPerRequest = 100000;
+static const size_t kMaxResponseBytes = 64 << 20;     // the whole response is built in memory
+static const int kIdleTimeoutSeconds = 10;            // how long a client may keep a worker waiting
+
+/**
+ * One served grammar and the ID of its <start> symbol.
+ */
+
+struct servedGrammar {
+  Grammar grammar;
+  int start;
+};
+
+typedef map<string, servedGrammar> grammarTable;
+
+/**
+ * Function: getGrammarName
+ * ------------------------
+ * Strips the directory and the .g extension from a grammar's
+ * file name to get the name clients ask for it by.
+ */
+
+static string getGrammarName(const string& fileName)
+{
+  string name = fileName.substr(fileName.find_last_of('/') + 1);
+  if (name.size() > 2 && name.compare(name.size() - 2, 2, ".g") == 0)
+    name.resize(name.size() - 2);
+  return name;
+}
+
+static bool loadGrammars(const vector<const char *>& fileNames, bool useSnapshot, grammarTable& grammars)
+{
+  for (size_t i = 0; i < fileNames.size(); i++) {
+    string name = getGrammarName(fileNames[i]);
+    if (grammars.count(name) > 0) {
+      cerr << "Two of the grammars would both be served as \"" << name << "\"." << endl;
+      return false;
+    }
+
+    servedGrammar& served = grammars[name];
+    if (!loadGrammar(fileNames[i], served.grammar, useSnapshot)) {
+      cerr << "Failed to load the file named \"" << fileNames[i] << "\".  Check to ensure the file exists"
+           << " and holds a well-formed grammar." << endl;
+      return false;
+    }
+
+    served.start = served.grammar.findNonterminal("<start>");
+    if (served.start == -1) {
+      cerr << "The grammar in \"" << fileNames[i] << "\" doesn't define <start>." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Function: parseNumber
+ * ---------------------
+ * Converts the entirety of the specified token to a nonnegative
+ * number, the way parseOptions in rsg.cc reads option values.
+ */
+
+static bool parseNumber(const string& token, unsigned long long& value)
+{
+  if (token.empty() || token[0] == '-') return false;
+  char *end;
+  errno = 0;
+  value = strtoull(token.c_str(), &end, 10);
+  return *end == '\0' && errno == 0;
+}
+
+/**
+ * Function: answerRequest
+ * -----------------------
+ * Parses one request line and runs it, leaving the text of a
+ * successful response in payload.
+ *
+ * @return the empty string on success, and otherwise the message
+ *         that belongs in the ERR response.
+ */
+
+static string answerRequest(const string& request, const grammarTable& grammars,
+                            const serverOptions& options, RandomGenerator& seeds, TextWriter& payload)
+{
+  istringstream tokens(request);
+  string name, count, seed, extra;
+  tokens >> name >> count >> seed >> extra;
+  if (name.empty() || count.empty() || !extra.empty())
+    return "expected <grammar-name> <count> [<seed>]";
+
+  grammarTable::const_iterator found = grammars.find(name);
+  if (found == grammars.end()) return "no grammar named " + name;
+
+  batchOptions batch;
+  unsigned long long value;
+  if (!parseNumber(count, value) || value == 0 || value > (unsigned long long) kMaxSentencesPerRequest)
+    return "count must be between 1 and " + to_string(kMaxSentencesPerRequest);
+  batch.count = value;
+  if (seed.empty()) {
+    batch.seed = ((uint64_t) seeds.getRandomBits() << 32) | seeds.getRandomBits();
+  } else {
+    if (!parseNumber(seed, value)) return "the seed must be a nonnegative integer";
+    batch.seed = value;
+  }
+  batch.threads = 1;  // the other workers are busy with other clients
+  batch.maxDepth = options.maxDepth;
+  batch.maxTokens = options.maxTokens;
+  batch.maxBytes = kMaxResponseBytes;
+
+  // writing to an in-memory payload can't fail, and sentences that grow past
+  // the limits are redrawn just as rsg --count redraws them
+  long numRedrawn;
+  payload.clear();
+  batchStatus status = generateBatch(found->second.grammar, found->second.start, batch, payload, numRedrawn);
+  if (status == kBatchTooLarge) {
+    payload.clear();
+    return "the response would be longer than " + to_string(kMaxResponseBytes) + " bytes";
+  }
+  if (status != kBatchComplete) return "some sentence kept growing past the expansion limits";
+  return "";
+}
+
+/**
+ * Function: serveConnection
+ * -------------------------
+ * Reads requests from the client one line at a time, answering
+ * each one before reading the next, until the client closes the
+ * connection, sends a request that's too long to be legitimate,
+ * stops accepting responses, or goes kIdleTimeoutSeconds without
+ * sending or taking anything (acceptConnections sets the socket's
+ * timeouts, so a read or write that waits that long fails).
+ */
+
+static void serveConnection(int client, const grammarTable& grammars, const serverOptions& options,
+                            RandomGenerator& seeds)
+{
+  TextWriter out(client);
+  TextWriter payload;
+  string pending;
+  char bytes[4096];
+  while (true) {
+    size_t newline;
+    while ((newline = pending.find('\n')) == string::npos) {
+      if (pending.size() > kMaxRequestLength) {
+        out.write("ERR request too long\n");
+        return;
+      }
+      ssize_t numRead = read(client, bytes, sizeof(bytes));
+      if (numRead == -1 && errno == EINTR) continue;
+      if (numRead <= 0) return;
+      pending.append(bytes, numRead);
+    }
+
+    string request = pending.substr(0, newline);
+    pending.erase(0, newline + 1);
+    if (!request.empty() && request[request.size() - 1] == '\r') request.resize(request.size() - 1);
+
+    string error = answerRequest(request, grammars, options, seeds, payload);
+    if (error.empty()) {
+      out.write("OK " + to_string(payload.getText().size()) + "\n");
+      out.write(payload.getText());
+    } else {
+      out.write("ERR " + error + "\n");
+    }
+    if (!out.flush()) return;
+  }
+}
+
+/**
+ * Function: acceptConnections
+ * ---------------------------
+ * The body of each worker thread.  Errors that concern a single
+ * connection are shrugged off; anything else (running out of file
+ * descriptors, say) is reported and retried after a short pause
+ * rather than spinning.  Every connection gets a receive and a send
+ * timeout, so a client that connects and then goes quiet ties its
+ * worker up for kIdleTimeoutSeconds at most.
+ */
+
+static void acceptConnections(int listener, const grammarTable& grammars, const serverOptions& options,
+                              int worker)
+{
+  RandomGenerator seeds(time(NULL), worker);
+  while (true) {
+    int client = accept(listener, NULL, NULL);
+    if (client == -1) {
+      if (errno != EINTR && errno != ECONNABORTED) {
+        cerr << "accept: " << strerror(errno) << endl;
+        sleep(1);
+      }
+      continue;
+    }
+    struct timeval timeout = { kIdleTimeoutSeconds, 0 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    serveConnection(client, grammars, options, seeds);
+    close(client);
+  }
+}
+
+static int createListener(const char *socketPath)
+{
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(socketPath) >= sizeof(address.sun_path)) {
+    cerr << "The socket path \"" << socketPath << "\" is too long." << endl;
+    return -1;
+  }
+  strcpy(address.sun_path, socketPath);
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener == -1) {
+    cerr << "socket: " << strerror(errno) << endl;
+    return -1;
+  }
+
+  unlink(socketPath);  // a socket left behind by an earlier server would make bind fail
+  if (bind(listener, (struct sockaddr *) &address, sizeof(address)) == -1 || listen(listener, SOMAXCONN) == -1) {
+    cerr << "Couldn't listen on \"" << socketPath << "\": " << strerror(errno) << endl;
+    close(listener);
+    return -1;
+  }
+  return listener;
+}
+
+bool serveGrammars(const vector<const char *>& grammarFileNames, const serverOptions& options)
+{
+  grammarTable grammars;
+  if (!loadGrammars(grammarFileNames, options.useSnapshot, grammars)) return false;
+
+  int listener = createListener(options.socketPath);
+  if (listener == -1) return false;
+
+  signal(SIGPIPE, SIG_IGN);  // a client that hangs up early should fail a write, not kill the server
+  cerr << "Serving " << grammars.size() << " grammar(s) on " << options.socketPath
+       << " with " << options.threads << " worker(s)." << endl;
+
+  vector<thread> workers;
+  for (int i = 1; i < options.threads; i++)
+    workers.push_back(thread(acceptConnections, listener, cref(grammars), cref(options), i));
+  acceptConnections(listener, grammars, options, 0);  // never returns
+  return true;
+}
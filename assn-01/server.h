@@ -0,0 +1,66 @@
+#ifndef __server__
+#define __server__
+
+/**
+ * File: server.h
+ * --------------
+ * Provides rsg's server mode, which loads any number of grammars
+ * once and then generates text from them on request, over a Unix
+ * domain socket, for as long as it's left running.  The protocol
+ * is line-based.  A request is a single line of the form
+ *
+ *     <grammar-name> <count> [<seed>]
+ *
+ * where the grammar name is the grammar file's name without its
+ * directory or its .g extension (data/bionic.g is served as bionic).
+ * The response is either
+ *
+ *     OK <number of bytes>\n<exactly that many bytes of text>
+ *
+ * where the text is precisely what rsg --count <count> --seed <seed>
+ * would have printed, and so always holds exactly <count> sentences,
+ * or a single line of the form ERR <message>\n (sent, among other
+ * reasons, when some sentence can't be generated within the expansion
+ * limits, or when the text would run past 64MB, since every response
+ * is built in memory before it's sent).  A client may send any number
+ * of requests over one connection.
+ */
+
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Bundles the knobs that control a server.
+ */
+
+struct serverOptions {
+  const char *socketPath;   // where the listening socket is created
+  int threads;              // number of worker threads, and so of clients served at once
+  int maxDepth;             // per-sentence limits handed to each Expander
+  int maxTokens;
+  bool useSnapshot;         // whether grammars may be loaded from (and saved as) snapshots
+};
+
+/**
+ * Function: serveGrammars
+ * -----------------------
+ * Loads every one of the specified grammars, creates a listening
+ * socket at options.socketPath (replacing whatever's already there),
+ * and starts options.threads workers, each of which accepts a
+ * connection on the shared socket and answers its requests until
+ * the client closes it or leaves it idle for ten seconds, so clients
+ * that connect and go quiet can't hold on to every worker.  The loaded
+ * grammars are shared, read-only, by all of the workers.  Requests
+ * without a seed get one of their own, drawn from the worker's own
+ * generator.
+ *
+ * @param grammarFileNames the paths of the .g files to serve.
+ * @param options the socket, thread, limit, and snapshot settings.
+ * @return false if the server couldn't be started; once it's
+ *         running, it never returns.
+ */
+
+bool serveGrammars(const vector<const char *>& grammarFileNames, const serverOptions& options);
+
+#endif // ! __server__
@@ -0,0 +1,90 @@
+/**
+ * File: textwriter.cc
+ * -------------------
+ * Implements the TextWriter class shared by every one of
+ * rsg's output modes.
+ */
+
+#include "textwriter.h"
+#include <unistd.h>
+#include <errno.h>
+
+TextWriter::TextWriter(int fd, int lineLengthLimit, size_t bufferSize) :
+  fd(fd), lineLengthLimit(lineLengthLimit), bufferSize(bufferSize),
+  currentLineLength(0), failed(false)
+{
+  if (fd != -1) buffer.reserve(bufferSize + lineLengthLimit);
+}
+
+TextWriter::~TextWriter()
+{
+  flush();
+}
+
+void TextWriter::endText()
+{
+  buffer += '\n';
+  currentLineLength = 0;
+  flushIfFull();
+}
+
+/**
+ * Method: write
+ * -------------
+ * Text too big to fit in the buffer isn't copied into it at all:
+ * whatever's buffered goes out first, and then the text itself.
+ */
+
+void TextWriter::write(string_view text)
+{
+  if (fd != -1 && buffer.size() + text.size() > bufferSize) {
+    flush();
+    if (text.size() > bufferSize) {
+      writeAll(text.data(), text.size());
+      return;
+    }
+  }
+  buffer += text;
+  flushIfFull();
+}
+
+void TextWriter::writeSpanByWord(string_view span)
+{
+  size_t wordStart = 0;
+  for (size_t i = 0; i < span.size(); i++) {
+    if (span[i] != ' ') continue;
+    writeWord(span.substr(wordStart, i - wordStart));
+    wordStart = i + 1;
+  }
+}
+
+bool TextWriter::flush()
+{
+  if (fd == -1) return !failed;
+  writeAll(buffer.data(), buffer.size());
+  buffer.clear();
+  return !failed;
+}
+
+/**
+ * Method: writeAll
+ * ----------------
+ * write(2) may take fewer bytes than it's offered, and it may be
+ * interrupted before taking any, so it's called until either all
+ * of the bytes have been taken or a real error comes up.
+ */
+
+void TextWriter::writeAll(const char *bytes, size_t size)
+{
+  size_t written = 0;
+  if (failed) return;
+  while (written < size) {
+    ssize_t result = ::write(fd, bytes + written, size - written);
+    if (result == -1 && errno == EINTR) continue;
+    if (result <= 0) {
+      failed = true;
+      return;
+    }
+    written += result;
+  }
+}
@@ -0,0 +1,171 @@
+#ifndef __textwriter__
+#define __textwriter__
+
+/**
+ * File: textwriter.h
+ * ------------------
+ * Defines the TextWriter class, which lays generated words out as
+ * text--wrapping lines the way rsg always has--as they're produced.
+ * Words are never collected anywhere: each one is formatted straight
+ * into a large output buffer, and the buffer is handed to the
+ * operating system in one write whenever it fills up, so the memory
+ * needed to print a text doesn't grow with the length of the text.
+ */
+
+#include <string>
+#include <string_view>
+using namespace std;
+
+class TextWriter {
+
+ public:
+
+  static const int kDefaultLineLengthLimit = 40;
+  static const size_t kDefaultBufferSize = 1 << 16;
+
+  /**
+   * Constructor: TextWriter
+   * -----------------------
+   * Constructs a TextWriter that streams to the specified file
+   * descriptor, or, if fd is -1, one that simply accumulates all
+   * of its text in memory until the client collects it with getText.
+   *
+   * @param fd the descriptor to write to, or -1.
+   * @param lineLengthLimit the most characters (spaces not included)
+   *                        a line may hold before it's wrapped.
+   * @param bufferSize the number of bytes buffered between writes.
+   */
+
+  TextWriter(int fd = -1, int lineLengthLimit = kDefaultLineLengthLimit,
+             size_t bufferSize = kDefaultBufferSize);
+
+  /**
+   * Destructor: ~TextWriter
+   * -----------------------
+   * Flushes whatever's still buffered.
+   */
+
+  ~TextWriter();
+
+  /**
+   * Method: writeWord
+   * -----------------
+   * Writes the specified word followed by a single space.  Word
+   * lengths are tallied as they're written, and as soon as the tally
+   * exceeds the line length limit a newline is emitted ahead of the
+   * word and the tally starts over.
+   */
+
+  void writeWord(string_view word);
+
+  /**
+   * Method: writeSpan
+   * -----------------
+   * Writes a run of words that's already been rendered as text,
+   * each word followed by a single space, exactly as writeWord would
+   * have written them one at a time.  When the whole run fits on the
+   * current line it's copied in one piece.
+   *
+   * @param span the rendered words, say "a dark and stormy ".
+   * @param numWords the number of words (and so of spaces) in span.
+   */
+
+  void writeSpan(string_view span, int numWords);
+
+  /**
+   * Method: endText
+   * ---------------
+   * Ends the text currently being written with a newline, so that
+   * the next word starts a fresh line with a fresh tally.
+   */
+
+  void endText();
+
+  /**
+   * Method: write
+   * -------------
+   * Writes the specified text exactly as is, with no wrapping.
+   * Meant for banners, blank lines, and text that's already been
+   * formatted by some other TextWriter.
+   */
+
+  void write(string_view text);
+
+  /**
+   * Method: flush
+   * -------------
+   * Hands everything buffered so far to the file descriptor.
+   * In-memory TextWriters have nothing to flush.
+   *
+   * @return false if some write has ever failed, and true otherwise.
+   */
+
+  bool flush();
+
+  /**
+   * Methods: getText, clear, truncate
+   * ---------------------------------
+   * Provide access to (and ways to discard) the text buffered
+   * by an in-memory TextWriter.  truncate keeps only the first size
+   * bytes, which should end a text, since the next word starts a
+   * fresh line.
+   */
+
+  const string& getText() const { return buffer; }
+  void clear() { buffer.clear(); currentLineLength = 0; }
+  void truncate(size_t size) { buffer.resize(size); currentLineLength = 0; }
+
+ private:
+  int fd;
+  int lineLengthLimit;
+  size_t bufferSize;
+  string buffer;
+  int currentLineLength;
+  bool failed;
+
+  void flushIfFull() { if (fd != -1 && buffer.size() >= bufferSize) flush(); }
+  void writeAll(const char *bytes, size_t size);
+  void writeSpanByWord(string_view span);
+
+  // TextWriters own their buffers and are neither copied nor assigned.
+  TextWriter(const TextWriter& original);
+  TextWriter& operator=(const TextWriter& rhs);
+};
+
+/**
+ * writeWord and writeSpan are called for nearly every word of
+ * output, so they're defined here where they can be inlined.
+ */
+
+inline void TextWriter::writeWord(string_view word)
+{
+  currentLineLength += word.length();
+  if (currentLineLength > lineLengthLimit) {
+    buffer += '\n';
+    currentLineLength = 0;
+  }
+  buffer += word;
+  buffer += ' ';
+  flushIfFull();
+}
+
+/**
+ * The tally only ever grows within a line, so if it stays within the
+ * limit after the entire span, it did so after every word along the
+ * way, and none of them would have been wrapped.  Spans that cross
+ * the limit are rare and are written a word at a time.
+ */
+
+inline void TextWriter::writeSpan(string_view span, int numWords)
+{
+  int spanLength = span.length() - numWords;  // spaces aren't tallied
+  if (currentLineLength + spanLength > lineLengthLimit) {
+    writeSpanByWord(span);
+    return;
+  }
+  currentLineLength += spanLength;
+  buffer += span;
+  flushIfFull();
+}
+
+#endif // ! __textwriter__
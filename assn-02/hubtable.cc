@@ -0,0 +1,171 @@
+/**
+ * File: hubtable.cc
+ * -----------------
+ * Implements the hubTable class, which either builds a table with one
+ * breadth-first search or maps one that's already been saved.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include "hubtable.h"
+using namespace std;
+
+//a table file starts with a header of kHeaderInts ints: the magic number (8 bytes),
+//the format version, the number of actors, the number of films, the hub's ordinal,
+//and the signature of the actor and movie files it was built from.  The header is
+//followed by every actor's parent, every actor's film, and every actor's distance,
+//one byte each, padded out to a whole number of ints.
+static const char kMagic[8] = {'I', 'M', 'D', 'B', 'H', 'U', 'B', '\0'};
+static const int kVersion = 2;
+static const int kVersionField = 2;
+static const int kNumFilmsField = 4;
+static const int kSignatureField = 6;
+static const int kHeaderInts = kSignatureField + sizeof(dataSignature) / sizeof(int);
+
+static size_t getNumInts(int numActors)
+{
+  return kHeaderInts + 2 * (size_t) numActors + (numActors + 3) / 4;
+}
+
+hubTable::hubTable() : header(NULL), parents(NULL), films(NULL), distances(NULL)
+{
+  info.fd = -1;
+  info.fileMap = NULL;
+}
+
+/**
+ * Points header, parents, films, and distances into a table
+ * whose first int is start.
+ */
+
+void hubTable::useImage(const int *start)
+{
+  int numActors = start[kNumActorsField];
+  header = start;
+  parents = header + kHeaderInts;
+  films = parents + numActors;
+  distances = (const unsigned char *) (films + numActors);
+}
+
+bool hubTable::build(const imdb& db, int hub)
+{
+  release();
+  int numActors = db.getNumActors();
+  image.assign(getNumInts(numActors), 0);
+  memcpy(&image[0], kMagic, sizeof(kMagic));
+  image[kVersionField] = kVersion;
+  image[kNumActorsField] = numActors;
+  image[kNumFilmsField] = db.getNumFilms();
+  image[kHubField] = hub;
+  memcpy(&image[kSignatureField], &db.getSignature(), sizeof(dataSignature));
+
+  int *parentsOut = &image[kHeaderInts];
+  int *filmsOut = parentsOut + numActors;
+  unsigned char *distancesOut = (unsigned char *) (filmsOut + numActors);
+  fill(parentsOut, parentsOut + 2 * numActors, -1);
+  memset(distancesOut, kUnreachable, numActors);
+
+  // level by level, so that the distance can't outgrow a byte unnoticed
+  vector<bool> seenFilms(db.getNumFilms(), false);
+  vector<int> frontier(1, hub), next;
+  distancesOut[hub] = 0;
+  for (int distance = 1; !frontier.empty(); distance++) {
+    next.clear();
+    for (int i = 0; i < (int) frontier.size(); i++) {
+      int filmAmount;
+      const int *credits = db.getCreditOrdinals(frontier[i], filmAmount);
+      for (int j = 0; j < filmAmount; j++) {
+        if (seenFilms[credits[j]]) continue;
+        seenFilms[credits[j]] = true;
+        int actorsAmount;
+        const int *cast = db.getCastOrdinals(credits[j], actorsAmount);
+        for (int k = 0; k < actorsAmount; k++) {
+          int actor = cast[k];
+          if (distancesOut[actor] != kUnreachable) continue;
+          if (distance > kMaxDistance) {
+            image.clear();
+            return false;
+          }
+          distancesOut[actor] = distance;
+          parentsOut[actor] = frontier[i];
+          filmsOut[actor] = credits[j];
+          next.push_back(actor);
+        }
+      }
+    }
+    frontier.swap(next);
+  }
+
+  useImage(&image[0]);
+  return true;
+}
+
+bool hubTable::save(const string& fileName) const
+{
+  if (!good()) return false;
+  return writeIndexFile(fileName, header, getNumInts(getNumActors()) * sizeof(int));
+}
+
+bool hubTable::load(const imdb& db, const string& fileName)
+{
+  release();
+  const int *start = (const int *) acquireFileMap(fileName, info, db.getMappingPolicy());
+  if (start == NULL) return false;
+
+  // the header must describe these very data files, and every entry must be in range
+  bool valid = info.fileSize >= kHeaderInts * sizeof(int) &&
+    memcmp(start, kMagic, sizeof(kMagic)) == 0 && start[kVersionField] == kVersion &&
+    memcmp(&start[kSignatureField], &db.getSignature(), sizeof(dataSignature)) == 0;
+  int numActors = valid ? start[kNumActorsField] : 0;
+  valid = valid && numActors == db.getNumActors() && start[kNumFilmsField] == db.getNumFilms() &&
+    info.fileSize == getNumInts(numActors) * sizeof(int) &&
+    start[kHubField] >= 0 && start[kHubField] < numActors;
+  if (valid) {
+    useImage(start);
+    valid = distances[getHub()] == 0;
+    for (int i = 0; valid && i < numActors; i++) {
+      if (i == getHub() || distances[i] == kUnreachable)
+        valid = parents[i] == -1 && films[i] == -1;
+      else
+        valid = parents[i] >= 0 && parents[i] < numActors && films[i] >= 0 && films[i] < db.getNumFilms() &&
+          distances[parents[i]] == distances[i] - 1;
+    }
+  }
+  if (!valid) {
+    release();
+    return false;
+  }
+  return true;
+}
+
+void hubTable::getHistogram(vector<int>& histogram, int& unreachable) const
+{
+  histogram.clear();
+  unreachable = 0;
+  for (int i = 0; i < getNumActors(); i++) {
+    if (distances[i] == kUnreachable) {
+      unreachable++;
+      continue;
+    }
+    if (distances[i] >= (int) histogram.size())
+      histogram.resize(distances[i] + 1, 0);
+    histogram[distances[i]]++;
+  }
+}
+
+/**
+ * Forgets the table, unmapping it if it was loaded.
+ */
+
+void hubTable::release()
+{
+  releaseFileMap(info);
+  image.clear();
+  header = parents = films = NULL;
+  distances = NULL;
+}
+
+hubTable::~hubTable()
+{
+  release();
+}
@@ -0,0 +1,144 @@
+#ifndef __hubtable__
+#define __hubtable__
+
+#include "imdb.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: hubTable
+ * ---------------
+ * Records the outcome of one complete breadth-first search from a hub
+ * actor: for every actor in the database, how many films separate them
+ * from the hub (their "hub number", as in Bacon number), and the actor
+ * and film one step closer to the hub along a shortest path.  Following
+ * those steps from any actor leads back to the hub, so a shortest path
+ * between the hub and anyone takes time proportional to its length to
+ * produce, with no search at all.
+ *
+ * A table is built with build and saved with save (imdb-hub does both),
+ * and later mapped straight from its file with load.  Actors and films
+ * are identified by ordinal (see imdb::getActorOrdinal) throughout.
+ */
+
+class hubTable {
+
+ public:
+
+  /**
+   * Constructor: hubTable
+   * ---------------------
+   * Constructs an empty table, which isn't good until build or
+   * load succeeds.
+   */
+
+  hubTable();
+
+  /**
+   * Method: build
+   * -------------
+   * Runs a breadth-first search from the specified actor over the whole
+   * database and keeps the results in memory.  The imdb's adjacency
+   * index must already be loaded (see imdb::loadAdjacencyIndex), and
+   * the imdb must outlive the table.
+   *
+   * @param db the database to search.
+   * @param hub the ordinal of the hub actor.
+   * @return false if some actor is too far from the hub to be recorded
+   *         (kMaxDistance films or more), in which case the table is left empty.
+   */
+
+  bool build(const imdb& db, int hub);
+
+  /**
+   * Method: save
+   * ------------
+   * Writes the table to the specified file, which load can later map.
+   *
+   * @return true if and only if the whole file was written.
+   */
+
+  bool save(const string& fileName) const;
+
+  /**
+   * Method: load
+   * ------------
+   * Maps a table written by save, following the imdb's mapping policy,
+   * provided it was built from the very data files the specified imdb
+   * is layered on (see dataSignature), and checks that every entry in
+   * it is in range.
+   *
+   * @return true if and only if the table is ready to use.
+   */
+
+  bool load(const imdb& db, const string& fileName);
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if and only if build or load has succeeded.
+   */
+
+  bool good() const { return distances != NULL; }
+
+  /**
+   * Methods: getHub, getNumActors, getDistance, getParent, getFilm
+   * --------------------------------------------------------------
+   * getDistance returns the number of films between the hub and the
+   * specified actor, or -1 if the two aren't connected at all.  For
+   * an actor other than the hub that is connected to it, getParent
+   * returns the next actor along a shortest path to the hub, and getFilm
+   * the film the two appeared in; both return -1 for the hub itself and
+   * for unconnected actors.
+   */
+
+  int getHub() const { return header[kHubField]; }
+  int getNumActors() const { return header[kNumActorsField]; }
+  int getDistance(int actor) const { return distances[actor] == kUnreachable ? -1 : distances[actor]; }
+  int getParent(int actor) const { return parents[actor]; }
+  int getFilm(int actor) const { return films[actor]; }
+
+  /**
+   * Method: getHistogram
+   * --------------------
+   * Counts the actors at each distance from the hub.  histogram[d]
+   * ends up the number of actors d films away, and unreachable the
+   * number of actors with no connection to the hub.
+   */
+
+  void getHistogram(vector<int>& histogram, int& unreachable) const;
+
+  /**
+   * Destructor: ~hubTable
+   * ---------------------
+   * Unmaps the table if it was loaded.
+   */
+
+  ~hubTable();
+
+  static const int kMaxDistance = 254;
+
+ private:
+  static const unsigned char kUnreachable = 255;
+  static const int kNumActorsField = 3;
+  static const int kHubField = 5;
+
+  //the table is either built into image or mapped from a file; the four
+  //pointers lead into whichever one it is
+  vector<int> image;
+  struct fileInfo info;
+  const int *header;
+  const int *parents;
+  const int *films;
+  const unsigned char *distances;
+
+  void useImage(const int *start);
+  void release();
+
+  // tables can't be copied, since they may own a mapping
+  hubTable(const hubTable& original);
+  hubTable& operator=(const hubTable& rhs);
+};
+
+#endif
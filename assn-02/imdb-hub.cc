@@ -0,0 +1,91 @@
+/**
+ * File: imdb-hub.cc
+ * -----------------
+ * Builds the hub table for one actor (see hubtable.h): a breadth-first
+ * search from that actor over the whole database, saved as a file that
+ * six-degrees --hub can map to answer any question about the hub without
+ * searching.  With --histogram, it also prints how many actors are at
+ * each distance from the hub, along with the average distance among
+ * those connected to it.  The mapping options imdb-test takes (see
+ * parseMappingOption) may come before the actor's name as well.
+ *
+ * Usage: imdb-hub [--histogram] [<mapping options>] <actor name> <table file>
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "imdb.h"
+#include "hubtable.h"
+using namespace std;
+
+/**
+ * Function: printHistogram
+ * ------------------------
+ * Prints one row per distance, followed by the number of
+ * actors the hub isn't connected to at all.
+ */
+
+static void printHistogram(const string& hubName, const hubTable& table)
+{
+  vector<int> histogram;
+  int unreachable;
+  table.getHistogram(histogram, unreachable);
+
+  long total = 0, connected = 0;
+  cout << "Distance from " << hubName << ":" << endl;
+  for (int distance = 0; distance < (int) histogram.size(); distance++) {
+    cout << setw(6) << distance << setw(12) << histogram[distance] << endl;
+    total += (long) distance * histogram[distance];
+    connected += histogram[distance];
+  }
+  cout << setw(6) << "none" << setw(12) << unreachable << endl;
+  cout << "Average distance over the " << connected << " connected actors: "
+       << fixed << setprecision(3) << (double) total / connected << endl;
+}
+
+int main(int argc, const char *argv[])
+{
+  bool histogram = false;
+  mappingPolicy policy;
+  int first = 1;
+  for (; first < argc && strncmp(argv[first], "--", 2) == 0; first++) {
+    if (strcmp(argv[first], "--histogram") == 0) histogram = true;
+    else if (!parseMappingOption(argc, argv, first, policy)) break;
+  }
+  if (argc != first + 2) {
+    cerr << "Usage: imdb-hub [--histogram] " << kMappingUsage << endl;
+    cerr << "                <actor name> <table file>" << endl;
+    return 1;
+  }
+  string hubName = argv[first];
+  string tableFileName = argv[first + 1];
+
+  imdb db(determinePathToData(), policy);
+  if (!db.good()) {
+    cerr << "Failed to properly initialize the imdb database." << endl;
+    return 1;
+  }
+  int hubOffset = db.getActorOffset(hubName);
+  if (hubOffset == -1) {
+    cerr << "We couldn't find \"" << hubName << "\" in the movie database." << endl;
+    return 2;
+  }
+
+  db.loadAdjacencyIndex();
+  hubTable table;
+  if (!table.build(db, db.getActorOrdinal(hubOffset))) {
+    cerr << "Some actor is more than " << hubTable::kMaxDistance << " films away from "
+         << hubName << ", which the table can't record." << endl;
+    return 3;
+  }
+  if (!table.save(tableFileName)) {
+    cerr << "Failed to write the table to \"" << tableFileName << "\"." << endl;
+    return 3;
+  }
+
+  if (histogram) printHistogram(hubName, table);
+  return 0;
+}
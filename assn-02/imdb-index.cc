@@ -0,0 +1,45 @@
+/**
+ * File: imdb-index.cc
+ * -------------------
+ * Writes the index files for a data directory into it: "adjacency",
+ * the actor/film graph in compressed sparse row form (see
+ * imdb::loadAdjacencyIndex), which six-degrees maps instead of building
+ * the graph every time it starts, and "lookup", the hash tables imdb
+ * uses to find actors and films by name (see imdb::writeLookupIndex).
+ * Each index records the signature of the data files it was built
+ * from (see dataSignature), and an index that no longer matches them
+ * is ignored, so rerun imdb-index whenever the data changes.
+ *
+ * Usage: imdb-index [<data directory>]
+ */
+
+#include <iostream>
+#include <string>
+#include "imdb.h"
+using namespace std;
+
+int main(int argc, const char *argv[])
+{
+  string directory = argc > 1 ? string(argv[1]) : determinePathToData();
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Failed to properly initialize the imdb database in \"" << directory << "\"." << endl;
+    return 1;
+  }
+
+  string adjacencyFileName = directory + "/adjacency";
+  if (!db.writeAdjacencyIndex(adjacencyFileName)) {
+    cerr << "Failed to write the adjacency index to \"" << adjacencyFileName << "\"." << endl;
+    return 2;
+  }
+
+  string lookupFileName = directory + "/lookup";
+  if (!db.writeLookupIndex(lookupFileName)) {
+    cerr << "Failed to write the lookup index to \"" << lookupFileName << "\"." << endl;
+    return 2;
+  }
+
+  cout << "Wrote the adjacency and lookup indexes for " << db.getNumActors() << " actors and "
+       << db.getNumFilms() << " films to \"" << directory << "\"." << endl;
+  return 0;
+}
@@ -3,9 +3,34 @@
 #include <map>
 #include <set>
 #include <string>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <new>
 #include "imdb.h"
 using namespace std;
 
+/**
+ * Every heap allocation made by this program passes through the
+ * replacement operator new below, so that the lookup benchmark can
+ * report how many allocations each lookup performs.
+ */
+
+static unsigned long numAllocations = 0;
+
+void *operator new(size_t size)
+{
+  numAllocations++;
+  void *memory = malloc(size == 0 ? 1 : size);
+  if (memory == NULL) throw bad_alloc();
+  return memory;
+}
+
+void operator delete(void *memory) noexcept { free(memory); }
+void operator delete(void *memory, size_t) noexcept { free(memory); }
+
 /**
  * Function: stall
  * ---------------
@@ -190,18 +215,286 @@ static void queryForActors(const imdb& db)
   }
 }
 
+/**
+ * Function: legacyFilmOffset
+ * --------------------------
+ * Looks a film up the way imdb originally did: a binary search whose
+ * every probe builds a film (title string and all) out of the record
+ * and compares it with operator== and then operator<.  Kept as the
+ * baseline the lookup benchmark measures against.
+ */
+
+static int legacyFilmOffset(const film& movie, const imdb& db)
+{
+  int low = 0, high = db.getNumFilms() - 1;
+  while (low <= high) {
+    int mid = low + (high - low) / 2;
+    film probe = db.getFilm(db.getFilmOffsetAt(mid));
+    if (movie == probe) return db.getFilmOffsetAt(mid);
+    if (movie < probe) high = mid - 1;
+    else low = mid + 1;
+  }
+  return -1;
+}
+
+/**
+ * Function: measureLookups
+ * ------------------------
+ * Calls lookup on every key, over and over, for about a second,
+ * and prints one row of the benchmark's results.  The checksum of the
+ * offsets found by one pass over the keys keeps the lookups from being
+ * optimized away, and lets the rows be compared with one another.
+ */
+
+template <typename Key, typename Lookup>
+static void measureLookups(const string& label, const vector<Key>& keys, Lookup lookup)
+{
+  const double kSecondsPerRow = 1.0;
+  unsigned long numLookups = 0, checksum = 0;
+  unsigned long allocationsBefore = numAllocations;
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  double seconds;
+  do {
+    checksum = 0;
+    for (size_t i = 0; i < keys.size(); i++) checksum += lookup(keys[i]);
+    numLookups += keys.size();
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+  } while (seconds < kSecondsPerRow);
+
+  cout << "    " << left << setw(16) << label << right << fixed
+       << setw(12) << setprecision(0) << numLookups / seconds << " lookups/sec"
+       << setw(8) << setprecision(2) << (double) (numAllocations - allocationsBefore) / numLookups
+       << " allocs/lookup    checksum " << checksum << endl;
+}
+
+/**
+ * Function: benchmarkLookups
+ * --------------------------
+ * Measures how quickly names and films are resolved to records: the
+ * original film comparator against the current getFilmOffset, and
+ * getActorOffset.  The keys are a fixed-seed shuffle of every actor and
+ * film in the database, so successive runs look up the same keys in
+ * the same order.  Both getActorOffset and getFilmOffset use the lookup
+ * index if imdb-index has written one; move it aside to measure the
+ * binary searches instead.
+ */
+
+static void benchmarkLookups(const imdb& db)
+{
+  vector<string> names;
+  for (int i = 0; i < db.getNumActors(); i++) names.push_back(db.getActorName(db.getActorOffsetAt(i)));
+  vector<film> films;
+  for (int i = 0; i < db.getNumFilms(); i++) films.push_back(db.getFilm(db.getFilmOffsetAt(i)));
+  mt19937 random(1);
+  shuffle(names.begin(), names.end(), random);
+  shuffle(films.begin(), films.end(), random);
+
+  cout << names.size() << " actors and " << films.size() << " films, looked up "
+       << (db.hasLookupIndex() ? "through the lookup index" : "by binary search") << ":" << endl;
+  measureLookups("films (legacy)", films, [&](const film& movie) { return legacyFilmOffset(movie, db); });
+  measureLookups("films", films, [&](const film& movie) { return db.getFilmOffset(movie); });
+  measureLookups("actors", names, [&](const string& player) { return db.getActorOffset(player); });
+}
+
+/**
+ * Function: matchesBatch
+ * ----------------------
+ * Checks one request's slice of a batch result against the films
+ * (or names) the per-actor (per-film) lookup produced.
+ */
+
+template <typename Item, typename Materialize>
+static bool matchesBatch(const vector<Item>& expected, const vector<int>& arena, const vector<int>& starts,
+                         int request, Materialize materialize)
+{
+  if (starts[request + 1] - starts[request] != (int) expected.size()) return false;
+  for (int i = 0; i < (int) expected.size(); i++)
+    if (!(materialize(arena[starts[request] + i]) == expected[i])) return false;
+  return true;
+}
+
+/**
+ * Function: checkBatches
+ * ----------------------
+ * Compares the batch getCreditOffsets and getCastOffsets against
+ * getCredits and getCast, request by request, over batches of random
+ * actors and films (fixed seed, duplicates and all) of every size up to
+ * a few thousand.  It then runs the same batches again through the same
+ * two vectors and makes sure the second round allocates nothing, as
+ * imdb.h promises once the vectors have grown large enough.
+ *
+ * @return true if and only if every check passed.
+ */
+
+static bool checkBatches(const imdb& db)
+{
+  const int kNumBatches = 200;
+  const int kMaxBatchSize = 4000;
+  mt19937 random(1);
+  vector<vector<int> > actorBatches(kNumBatches), filmBatches(kNumBatches);
+  for (int b = 0; b < kNumBatches; b++) {
+    int size = random() % (kMaxBatchSize + 1);
+    for (int i = 0; i < size; i++) {
+      actorBatches[b].push_back(db.getActorOffsetAt(random() % db.getNumActors()));
+      filmBatches[b].push_back(db.getFilmOffsetAt(random() % db.getNumFilms()));
+    }
+  }
+
+  long numRequests = 0, numMismatches = 0;
+  vector<int> arena, starts;
+  vector<film> credits;
+  vector<string> cast;
+  for (int b = 0; b < kNumBatches; b++) {
+    db.getCreditOffsets(actorBatches[b], arena, starts);
+    for (int i = 0; i < (int) actorBatches[b].size(); i++) {
+      credits.clear();
+      db.getCredits(db.getActorName(actorBatches[b][i]), credits);
+      if (!matchesBatch(credits, arena, starts, i, [&](int offset) { return db.getFilm(offset); })) numMismatches++;
+    }
+
+    db.getCastOffsets(filmBatches[b], arena, starts);
+    for (int i = 0; i < (int) filmBatches[b].size(); i++) {
+      cast.clear();
+      db.getCast(db.getFilm(filmBatches[b][i]), cast);
+      if (!matchesBatch(cast, arena, starts, i, [&](int offset) { return string(db.getActorName(offset)); })) numMismatches++;
+    }
+    numRequests += actorBatches[b].size() + filmBatches[b].size();
+  }
+
+  unsigned long allocationsBefore = numAllocations;
+  for (int b = 0; b < kNumBatches; b++) {
+    db.getCreditOffsets(actorBatches[b], arena, starts);
+    db.getCastOffsets(filmBatches[b], arena, starts);
+  }
+  unsigned long numAllocated = numAllocations - allocationsBefore;
+
+  cout << numRequests << " requests in " << 2 * kNumBatches << " batches: " << numMismatches
+       << " mismatches, " << numAllocated << " allocations once the vectors had grown" << endl;
+  return numMismatches == 0 && numAllocated == 0;
+}
+
+/**
+ * Function: millisecondsSince
+ * ---------------------------
+ * Self-explanatory.
+ */
+
+static double millisecondsSince(chrono::steady_clock::time_point begin)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+}
+
+/**
+ * Function: reportLatency
+ * -----------------------
+ * Reports what the specified mapping policy costs up front and what
+ * it saves the first queries: how long the imdb takes to open, and how
+ * long the first query and the ones after it take.  A query is what
+ * imdb-test itself does for a name: getCredits, and then getCast for
+ * every one of the films.  The actors are picked at random with a fixed
+ * seed, so every run asks the same questions.  Only the first run after
+ * the page cache has been dropped (echo 3 > /proc/sys/vm/drop_caches,
+ * as root) shows what a freshly booted server would see.
+ */
+
+static void reportLatency(const mappingPolicy& policy)
+{
+  const int kNumQueries = 1000;
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  imdb db(determinePathToData(), policy);
+  double openMilliseconds = millisecondsSince(begin);
+  if (!db.good()) { cerr << "Data directory not found!  Aborting..." << endl; return; }
+
+  mt19937 random(1);
+  vector<double> latencies;
+  vector<film> credits;
+  vector<string> cast;
+  for (int i = 0; i < kNumQueries; i++) {
+    string player = db.getActorName(db.getActorOffsetAt(random() % db.getNumActors()));
+    begin = chrono::steady_clock::now();
+    credits.clear();
+    db.getCredits(player, credits);
+    for (int j = 0; j < (int) credits.size(); j++) {
+      cast.clear();
+      db.getCast(credits[j], cast);
+    }
+    latencies.push_back(millisecondsSince(begin));
+  }
+
+  double later = 0;
+  for (int i = 1; i < kNumQueries; i++) later += latencies[i];
+  sort(latencies.begin() + 1, latencies.end());
+  cout << "prefault " << (policy.prefault ? "yes" : "no")
+       << ", advice " << (policy.advice == kAdviseRandom ? "random" : policy.advice == kAdviseWillNeed ? "willneed" : "normal")
+       << ", huge pages " << (policy.hugePages ? "yes" : "no")
+       << ", mlock " << (policy.lock ? "yes" : "no") << ":" << endl;
+  cout << fixed << setprecision(3)
+       << "    open                  " << setw(10) << openMilliseconds << " ms" << endl
+       << "    first query           " << setw(10) << latencies[0] << " ms" << endl
+       << "    later queries, mean   " << setw(10) << later / (kNumQueries - 1) << " ms" << endl
+       << "    later queries, p99    " << setw(10) << latencies[kNumQueries * 99 / 100] << " ms" << endl
+       << "    open + all queries    " << setw(10) << openMilliseconds + latencies[0] + later << " ms" << endl;
+}
+
+/**
+ * Function: parsePolicy
+ * ---------------------
+ * Reads the mapping options (see parseMappingOption) into policy, and
+ * sets mode to the mode flag (--benchmark, --latency, --check-batches),
+ * if there is one.  They may come in any order.
+ *
+ * @return false if the command line made no sense, including if it
+ *         named more than one mode.
+ */
+
+static bool parsePolicy(int argc, char **argv, mappingPolicy& policy, string& mode)
+{
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (parseMappingOption(argc, argv, i, policy)) continue;
+    if ((arg == "--benchmark" || arg == "--latency" || arg == "--check-batches") && mode.empty()) mode = arg;
+    else return false;
+  }
+  return true;
+}
+
 /**
  * Function: main
  * --------------
  * Defines the entry point for the unit testing
  * program that exercises the imdb class.  Notice
  * that the imdb constructor is called, 
+ *
+ * Run as imdb-test --benchmark, it measures lookups
+ * per second instead of taking queries, and run as
+ * imdb-test --latency, it reports startup and first-query
+ * latency (see reportLatency), and run as imdb-test
+ * --check-batches, it tests the batch lookups against the
+ * single ones (see checkBatches).  Whatever the mode, the mapping
+ * options described in parsePolicy may come before or after it.
  */
 
 int main(int argc, char **argv)
 {
-  imdb db(determinePathToData());
+  mappingPolicy policy;
+  string mode;
+  if (!parsePolicy(argc, argv, policy, mode)) {
+    cerr << "Usage: imdb-test " << kMappingUsage << endl;
+    cerr << "                 [--benchmark | --latency | --check-batches]" << endl;
+    return 1;
+  }
+  if (mode == "--latency") {
+    reportLatency(policy);
+    return 0;
+  }
+
+  imdb db(determinePathToData(), policy);
   if (!db.good()) { cerr << "Data directory not found!  Aborting..." << endl; return 1; }
+  if (mode == "--benchmark") {
+    benchmarkLookups(db);
+    return 0;
+  }
+  if (mode == "--check-batches") return checkBatches(db) ? 0 : 1;
   queryForActors(db);
   return 0;
 }
@@ -1,28 +1,433 @@
 using namespace std;
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <sys/mman.h>
-#include <fcntl.h>
-#include <unistd.h>
 #include <string.h>
+#include <algorithm>
 #include "imdb.h"
 
 const char *const imdb::kActorFileName = "actordata";
 const char *const imdb::kMovieFileName = "moviedata";
+const char *const imdb::kAdjacencyFileName = "adjacency";
+const char *const imdb::kLookupFileName = "lookup";
 
-imdb::imdb(const string& directory)
+//an index file's header holds the signature of the data files it was built from
+static const int kSignatureInts = sizeof(dataSignature) / sizeof(int);
+
+//the adjacency file starts with a header of kAdjacencyHeaderInts ints: the magic
+//number (8 bytes), the format version, the number of actors, films, and credits,
+//and the signature of the actor and movie files it was built from.  The header is
+//followed by the actors' credit starts (one more than there are actors), all of
+//the credits, the films' cast starts, and all of the cast members.
+static const char kAdjacencyMagic[8] = {'I', 'M', 'D', 'B', 'C', 'S', 'R', '\0'};
+static const int kAdjacencyVersion = 2;
+static const int kAdjacencyHeaderInts = 6 + kSignatureInts;
+
+imdb::imdb(const string& directory, const mappingPolicy& policy) : policy(policy)
 {
     const string actorFileName = directory + "/" + kActorFileName;
     const string movieFileName = directory + "/" + kMovieFileName;
 
-    actorFile = acquireFileMap(actorFileName, actorInfo);
-    movieFile = acquireFileMap(movieFileName, movieInfo);
+    actorFile = acquireFileMap(actorFileName, actorInfo, policy);
+    movieFile = acquireFileMap(movieFileName, movieInfo, policy);
+    adjacencyFileName = directory + "/" + kAdjacencyFileName;
+    adjacencyInfo.fd = -1;
+    adjacencyInfo.fileMap = NULL;
+    creditStarts = credits = castStarts = cast = NULL;
+    lookupInfo.fd = -1;
+    lookupInfo.fileMap = NULL;
+    actorSlots = filmSlots = NULL;
+    memset(&signature, 0, sizeof(signature));
+    if(!good())
+        return;
+
+    //a file whose offset table doesn't fit, or leads outside the file, is as good as missing
+    if(!isValidOffsetTable(actorFile, actorInfo.fileSize) ||
+        !isValidOffsetTable(movieFile, movieInfo.fileSize))
+    {
+        releaseFileMap(actorInfo);
+        releaseFileMap(movieInfo);
+        return;
+    }
+
+    signature.actorFileSize = actorInfo.fileSize;
+    signature.movieFileSize = movieInfo.fileSize;
+    signature.actorModified = actorInfo.modified;
+    signature.movieModified = movieInfo.modified;
+    signature.actorHash = hashOffsetTable(actorFile);
+    signature.movieHash = hashOffsetTable(movieFile);
+    loadLookupIndex(directory + "/" + kLookupFileName);
+}
+
+/**checks a data file's offset table
+ * @param file: the mapped data file
+ * @param fileSize: the size of the data file in bytes
+ * @return false if the offset table runs off the end of the file or holds
+ *         an offset that doesn't point past the table and inside the file
+*/
+bool imdb::isValidOffsetTable(const void *file, size_t fileSize)
+{
+    int recordAmount = *(int*)file;
+    if(recordAmount < 0 || (size_t)recordAmount >= fileSize / 4)
+        return false;
+    const int *offsets = (int*)file + 1;
+    for(int i = 0; i < recordAmount; i++)
+        if(offsets[i] < 4 * (recordAmount + 1) || (size_t)offsets[i] >= fileSize || offsets[i] % 4 != 0)
+            return false;
+    return true;
+}
+
+/**64-bit FNV-1a, over a data file's record count and offset table, which
+ * the constructor has already checked
+*/
+uint64_t imdb::hashOffsetTable(const void *file)
+{
+    const unsigned char *bytes = (const unsigned char*)file;
+    size_t size = 4 * ((size_t)*(int*)file + 1);
+    uint64_t hash = 14695981039346656037ULL;
+    for(size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    return hash;
+}
+
+/**maps every record's offset to its position in the file's offset table,
+ * which the constructor has already checked
+ * @param ordinals: resized to one entry per 4 bytes of the file; entries
+ *                  that don't start a record are left -1
+*/
+void imdb::buildOrdinals(const void *file, size_t fileSize, vector<int>& ordinals)
+{
+    int recordAmount = *(int*)file;
+    const int *offsets = (int*)file + 1;
+    ordinals.assign(fileSize / 4, -1);
+    for(int i = 0; i < recordAmount; i++)
+        ordinals[offsets[i] / 4] = i;
+}
+
+const int *imdb::getActorOrdinals() const
+{
+    call_once(actorOrdinalsBuilt, buildOrdinals, actorFile, actorInfo.fileSize, ref(actorOrdinals));
+    return &actorOrdinals[0];
+}
+
+const int *imdb::getFilmOrdinals() const
+{
+    call_once(filmOrdinalsBuilt, buildOrdinals, movieFile, movieInfo.fileSize, ref(filmOrdinals));
+    return &filmOrdinals[0];
+}
+
+/**lays the whole adjacency index out in one array, header included, the
+ * way it's stored in the adjacency file
+ * @param image: replaced with the index
+*/
+void imdb::buildAdjacencyImage(vector<int>& image) const
+{
+    int numActors = getNumActors();
+    int numFilms = getNumFilms();
+
+    //count first, so that each of the two halves is filled in one pass
+    int numCredits = 0;
+    for(int i = 0; i < numActors; i++)
+        numCredits += getActorRecord(getActorOffsetAt(i)).films().size();
+
+    image.assign(kAdjacencyHeaderInts, 0);
+    memcpy(&image[0], kAdjacencyMagic, sizeof(kAdjacencyMagic));
+    image[2] = kAdjacencyVersion;
+    image[3] = numActors;
+    image[4] = numFilms;
+    image[5] = numCredits;
+    memcpy(&image[6], &signature, sizeof(signature));
+    image.reserve(kAdjacencyHeaderInts + numActors + numFilms + 2 + 2 * (size_t)numCredits);
+
+    //actors' credits, as film ordinals (the tables are fetched once, since
+    //getFilmOrdinal and getActorOrdinal check that they've been built every call)
+    const int *filmOrdinalTable = getFilmOrdinals();
+    size_t starts = image.size();
+    image.resize(starts + numActors + 1);
+    for(int i = 0; i < numActors; i++)
+    {
+        image[starts + i] = (int)(image.size() - starts - numActors - 1);
+        for(int filmOffset : getActorRecord(getActorOffsetAt(i)).films())
+            image.push_back(filmOrdinalTable[filmOffset / 4]);
+    }
+    image[starts + numActors] = numCredits;
+
+    //films' casts, as actor ordinals
+    const int *actorOrdinalTable = getActorOrdinals();
+    starts = image.size();
+    image.resize(starts + numFilms + 1);
+    for(int i = 0; i < numFilms; i++)
+    {
+        image[starts + i] = (int)(image.size() - starts - numFilms - 1);
+        for(int actorOffset : getFilmRecord(getFilmOffsetAt(i)).actors())
+            image.push_back(actorOrdinalTable[actorOffset / 4]);
+    }
+    image[starts + numFilms] = (int)(image.size() - starts - numFilms - 1);
+}
+
+/**checks that an adjacency index belongs to the open data files and that
+ * none of its entries could lead outside of it
+ * @param image: the index, header included
+ * @param imageSize: the size of the index in bytes
+ * @return true if the index can be used as is
+*/
+bool imdb::isValidAdjacencyImage(const int *image, size_t imageSize) const
+{
+    if(imageSize < kAdjacencyHeaderInts * sizeof(int) ||
+        memcmp(image, kAdjacencyMagic, sizeof(kAdjacencyMagic)) != 0 ||
+        image[2] != kAdjacencyVersion)
+        return false;
+
+    int numActors = image[3], numFilms = image[4], numCredits = image[5];
+    if(numActors != getNumActors() || numFilms != getNumFilms() || numCredits < 0 ||
+        memcmp(&image[6], &signature, sizeof(signature)) != 0)
+        return false;
+    size_t numInts = kAdjacencyHeaderInts + numActors + numFilms + 2 + 2 * (size_t)numCredits;
+    if(imageSize != numInts * sizeof(int))
+        return false;
+
+    //both halves have the same shape: starts, then the ordinals they lead into
+    const int *half = image + kAdjacencyHeaderInts;
+    int numRows[] = {numActors, numFilms};
+    int numColumns[] = {numFilms, numActors};
+    for(int h = 0; h < 2; h++)
+    {
+        const int *starts = half;
+        const int *entries = starts + numRows[h] + 1;
+        if(starts[0] != 0 || starts[numRows[h]] != numCredits)
+            return false;
+        for(int i = 0; i < numRows[h]; i++)
+            if(starts[i] > starts[i + 1])
+                return false;
+        for(int i = 0; i < numCredits; i++)
+            if(entries[i] < 0 || entries[i] >= numColumns[h])
+                return false;
+        half = entries + numCredits;
+    }
+    return true;
+}
+
+/**points creditStarts, credits, castStarts, and cast into an adjacency index
+ * @param image: a valid index, header included
+*/
+void imdb::useAdjacencyImage(const int *image)
+{
+    int numActors = image[3], numFilms = image[4], numCredits = image[5];
+    creditStarts = image + kAdjacencyHeaderInts;
+    credits = creditStarts + numActors + 1;
+    castStarts = credits + numCredits;
+    cast = castStarts + numFilms + 1;
+}
+
+bool imdb::loadAdjacencyIndex()
+{
+    if(creditStarts != NULL)
+        return adjacencyInfo.fileMap != NULL;
+
+    const void *image = acquireFileMap(adjacencyFileName, adjacencyInfo, policy);
+    if(image != NULL)
+    {
+        if(isValidAdjacencyImage((const int*)image, adjacencyInfo.fileSize))
+        {
+            useAdjacencyImage((const int*)image);
+            return true;
+        }
+        releaseFileMap(adjacencyInfo);
+    }
+
+    buildAdjacencyImage(adjacencyImage);
+    useAdjacencyImage(&adjacencyImage[0]);
+    return false;
+}
+
+bool imdb::writeAdjacencyIndex(const string& fileName) const
+{
+    vector<int> image;
+    buildAdjacencyImage(image);
+    return writeIndexFile(fileName, &image[0], image.size() * sizeof(int));
+}
+
+//the lookup file starts with a header of kLookupHeaderInts ints: the magic number
+//(8 bytes), the format version, the number of actors and films, the number of
+//actor slots and of film slots, the signature of the actor and movie files it was
+//built from, and one int of padding.  The actor slots follow, and then the film slots.
+static const char kLookupMagic[8] = {'I', 'M', 'D', 'B', 'H', 'S', 'H', '\0'};
+static const int kLookupVersion = 3;
+static const int kLookupHeaderInts = 8 + kSignatureInts;
+
+/**32-bit FNV-1a, over the name's characters
+*/
+unsigned imdb::hashActor(const char *name, size_t length)
+{
+    unsigned hash = 2166136261u;
+    for(size_t i = 0; i < length; i++)
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    return hash;
+}
+
+/**32-bit FNV-1a, over the title's characters followed by the year byte
+*/
+unsigned imdb::hashFilm(const char *title, size_t length, char year)
+{
+    unsigned hash = hashActor(title, length);
+    return (hash ^ (unsigned char)year) * 16777619u;
+}
+
+/**probes the actor table for the specified name
+ * @return the offset of the actor's record, or -1 if there's no such actor
+*/
+int imdb::findActorSlot(const char *name, size_t length) const
+{
+    unsigned hash = hashActor(name, length);
+    const int *offsets = (const int*)actorFile;
+    for(unsigned i = hash & actorSlotMask; actorSlots[i].entry != 0; i = (i + 1) & actorSlotMask)
+    {
+        if(actorSlots[i].hash != hash)
+            continue;
+        const char *record = (const char*)actorFile + offsets[actorSlots[i].entry];
+        if(strncmp(record, name, length) == 0 && record[length] == '\0')
+            return offsets[actorSlots[i].entry];
+    }
+    return -1;
+}
+
+/**probes the film table for the specified title and year byte
+ * @return the offset of the film's record, or -1 if there's no such film
+*/
+int imdb::findFilmSlot(const char *title, size_t length, char year) const
+{
+    unsigned hash = hashFilm(title, length, year);
+    const int *offsets = (const int*)movieFile;
+    for(unsigned i = hash & filmSlotMask; filmSlots[i].entry != 0; i = (i + 1) & filmSlotMask)
+    {
+        if(filmSlots[i].hash != hash)
+            continue;
+        const char *record = (const char*)movieFile + offsets[filmSlots[i].entry];
+        if(strncmp(record, title, length) == 0 && record[length] == '\0' && record[length + 1] == year)
+            return offsets[filmSlots[i].entry];
+    }
+    return -1;
+}
+
+/**fills a table of numSlots slots (a power of two, larger than the
+ * number of records) from the records of one data file
+ * @param slots: the table, which must start out all zeroes
+ * @param isActorFile: whether the records are actors' or films'
+*/
+void imdb::fillLookupSlots(lookupSlot *slots, unsigned numSlots, const void *file, bool isActorFile)
+{
+    int recordAmount = *(int*)file;
+    const int *offsets = (int*)file + 1;
+    for(int i = 0; i < recordAmount; i++)
+    {
+        unsigned hash;
+        if(isActorFile)
+        {
+            string_view name = actorRecord((const char*)file + offsets[i]).name();
+            hash = hashActor(name.data(), name.size());
+        }
+        else
+        {
+            filmRecord movie((const char*)file + offsets[i]);
+            hash = hashFilm(movie.name().data(), movie.name().size(), (char)(movie.year() - 1900));
+        }
+
+        unsigned k = hash & (numSlots - 1);
+        while(slots[k].entry != 0)
+            k = (k + 1) & (numSlots - 1);
+        slots[k].hash = hash;
+        slots[k].entry = i + 1;
+    }
+}
+
+/**sizes a table for the specified number of records: the smallest
+ * power of two that keeps it at most half full
+*/
+static unsigned getNumLookupSlots(int numRecords)
+{
+    unsigned numSlots = 2;
+    while(numSlots < 2 * (unsigned)numRecords)
+        numSlots *= 2;
+    return numSlots;
+}
+
+bool imdb::writeLookupIndex(const string& fileName) const
+{
+    unsigned numActorSlots = getNumLookupSlots(getNumActors());
+    unsigned numFilmSlots = getNumLookupSlots(getNumFilms());
+    vector<int> image(kLookupHeaderInts + 2 * (size_t)(numActorSlots + numFilmSlots), 0);
+    memcpy(&image[0], kLookupMagic, sizeof(kLookupMagic));
+    image[2] = kLookupVersion;
+    image[3] = getNumActors();
+    image[4] = getNumFilms();
+    image[5] = (int)numActorSlots;
+    image[6] = (int)numFilmSlots;
+    memcpy(&image[7], &signature, sizeof(signature));
+
+    lookupSlot *slots = (lookupSlot*)&image[kLookupHeaderInts];
+    fillLookupSlots(slots, numActorSlots, actorFile, true);
+    fillLookupSlots(slots + numActorSlots, numFilmSlots, movieFile, false);
+    return writeIndexFile(fileName, &image[0], image.size() * sizeof(int));
+}
+
+/**checks that every occupied slot of a table holds an entry of the offset
+ * table, that there's one per record, and that at least one slot is empty,
+ * so that every probe ends
+*/
+bool imdb::isValidLookupSlots(const lookupSlot *slots, unsigned numSlots, int numRecords)
+{
+    int occupied = 0;
+    for(unsigned i = 0; i < numSlots; i++)
+    {
+        int entry = slots[i].entry;
+        if(entry == 0)
+            continue;
+        if(entry < 0 || entry > numRecords)
+            return false;
+        occupied++;
+    }
+    return occupied == numRecords && (unsigned)occupied < numSlots;
+}
+
+/**maps the lookup index if the file exists and its signature matches the open data
+ * files, and leaves actorSlots and filmSlots NULL otherwise
+*/
+void imdb::loadLookupIndex(const string& fileName)
+{
+    const int *image = (const int*)acquireFileMap(fileName, lookupInfo, policy);
+    if(image == NULL)
+        return;
+
+    size_t imageSize = lookupInfo.fileSize;
+    unsigned numActorSlots = 0, numFilmSlots = 0;
+    bool valid = imageSize >= kLookupHeaderInts * sizeof(int) &&
+        memcmp(image, kLookupMagic, sizeof(kLookupMagic)) == 0 && image[2] == kLookupVersion &&
+        image[3] == getNumActors() && image[4] == getNumFilms() &&
+        memcmp(&image[7], &signature, sizeof(signature)) == 0;
+    if(valid)
+    {
+        numActorSlots = image[5];
+        numFilmSlots = image[6];
+        valid = numActorSlots != 0 && (numActorSlots & (numActorSlots - 1)) == 0 &&
+            numFilmSlots != 0 && (numFilmSlots & (numFilmSlots - 1)) == 0 &&
+            imageSize == (kLookupHeaderInts + 2 * (size_t)numActorSlots + 2 * (size_t)numFilmSlots) * sizeof(int);
+    }
+
+    const lookupSlot *slots = (const lookupSlot*)(image + kLookupHeaderInts);
+    if(!valid || !isValidLookupSlots(slots, numActorSlots, getNumActors()) ||
+        !isValidLookupSlots(slots + numActorSlots, numFilmSlots, getNumFilms()))
+    {
+        releaseFileMap(lookupInfo);
+        return;
+    }
+
+    actorSlots = slots;
+    filmSlots = slots + numActorSlots;
+    actorSlotMask = numActorSlots - 1;
+    filmSlotMask = numFilmSlots - 1;
 }
 
 bool imdb::good() const
 {
-    return !( (actorInfo.fd == -1) || 
-        (movieInfo.fd == -1) ); 
+    return !( (actorInfo.fileMap == NULL) || 
+        (movieInfo.fileMap == NULL) ); 
 }
 
 /**compares two names
@@ -40,7 +445,8 @@ int imdb::namesCmp(const void* one, const void* two)
     return strcmp(name0, name1);
 }
 
-/**compares two films
+/**compares two films, straight against the bytes of the second one's
+ * record, so that no film or string is built for any probe
  * @param one: pointer to moviePair struct
  * @param two: pointer to the offset of the second film info in the film file
  * @return the result of comparison of films based on their name and year
@@ -49,115 +455,168 @@ int imdb::filmsCmp(const void* one, const void* two)
 {
     filmPair *fp = (filmPair*)one;
     int offset = *(int*)two;
-    char *secondFilmInfo = (char*)fp->filePtr + offset;
-    
-    film film1;
-    film1.title = string(secondFilmInfo);
-    film1.year = 1900 + (int)*((char*)secondFilmInfo + film1.title.length() + 1);
-
-    if(*fp->movie == film1)
-        return 0;
-    if(*fp->movie < film1)
-        return -1;
-    return 1;
+    const char *secondFilmInfo = (char*)fp->filePtr + offset;
+
+    //comparing the terminating \0's too means a title that's a prefix of the other comes first;
+    //strncmp rather than memcmp so the record is never read past its own \0
+    const string& title = fp->movie->title;
+    int result = strncmp(title.c_str(), secondFilmInfo, title.size() + 1);
+    if(result != 0)
+        return result;
+
+    int year = 1900 + (int)secondFilmInfo[title.size() + 1];
+    return (fp->movie->year > year) - (fp->movie->year < year);
 }
 
-bool imdb::getCredits(const string& player, vector<film>& films) const {
-    int actorAmount = *(int*)actorFile;
+int imdb::getActorOffset(const string& player) const
+{
+    if(actorSlots != NULL)
+        return findActorSlot(player.c_str(), player.size());
 
+    int actorAmount = *(int*)actorFile;
     void* startOfOffsets = (int*)actorFile + 1;
+
     //create an actorPair struct for comparison
-    const char *cstr = player.c_str();
     actorPair searchPair;
-    searchPair.name = cstr;
+    searchPair.name = player.c_str();
     searchPair.filePtr = actorFile;
 
     void *pointerToOffset = bsearch(&searchPair, startOfOffsets, actorAmount, sizeof(int), namesCmp);
-    //if the actor couldn't be found
     if(pointerToOffset == NULL)
-        return false;
-    
-    const void *startOfInfo = (char*)actorFile + *(int*)pointerToOffset;
-    //advance through the actor info
-    char *positionInActorFile = (char*)startOfInfo;
-    positionInActorFile += player.length() + 1;
-    if(player.length() % 2 == 0)               //skip the extra \0 after the name if needed
-        positionInActorFile++;
-
-    int filmAmount = (int)*(short*)positionInActorFile;
-    positionInActorFile += 2;
-    if((positionInActorFile - (char*)startOfInfo) % 4)      //skip two \0's after the amount of films if needed
-        positionInActorFile += 2;
+        return -1;
+    return *(int*)pointerToOffset;
+}
 
-    //iterate over the films of the actor, inserting them in the vector
-    for(int i = 0; i < filmAmount; i++)
+int imdb::getFilmOffset(const film& movie) const
+{
+    if(filmSlots != NULL)
     {
-        int offsetInMovieFile = *(int*)positionInActorFile;
-        film currFilm;
-        char* startOfFilmInfo = (char*)movieFile + offsetInMovieFile;
-        currFilm.title = string(startOfFilmInfo);
-        currFilm.year = 1900 + *(startOfFilmInfo + currFilm.title.length() + 1);
-        films.push_back(currFilm);
-        positionInActorFile += 4;
+        //the year is stored as a single byte counting from 1900
+        if(movie.year - 1900 < -128 || movie.year - 1900 > 127)
+            return -1;
+        return findFilmSlot(movie.title.c_str(), movie.title.size(), (char)(movie.year - 1900));
     }
 
-    return true;
-}
-
-bool imdb::getCast(const film& movie, vector<string>& players) const {
     int filmAmount = *(int*)movieFile;
     void *startOfOffsets = (int*)movieFile + 1;
-    
+
     //create a filmPair struct for searching
     filmPair searchPair;
     searchPair.movie = &movie;
     searchPair.filePtr = movieFile;
 
     void *pointerToOffset = bsearch(&searchPair, startOfOffsets, filmAmount, sizeof(int), filmsCmp);
-    //if the film can't be found
     if(pointerToOffset == NULL)
-        return false;
+        return -1;
+    return *(int*)pointerToOffset;
+}
 
-    const char *startOfInfo = (char*)movieFile + *(int*)pointerToOffset;
-    char *positionInInfo = (char*)startOfInfo + movie.title.length() + 2;   //2 bytes _ \0 at the end and the year
-    if(movie.title.length() % 2)        //extra \0 maybe
-        positionInInfo++;
+void imdb::getCreditOffsets(int actorOffset, vector<int>& filmOffsets) const
+{
+    neighborOffsets credits = getActorRecord(actorOffset).films();
+    filmOffsets.insert(filmOffsets.end(), credits.begin(), credits.end());
+}
 
-    int actorsAmount = (int)*(short*)positionInInfo;
-    positionInInfo += 2;
-    if((positionInInfo - startOfInfo) % 4)
-        positionInInfo += 2;
+void imdb::getCastOffsets(int filmOffset, vector<int>& actorOffsets) const
+{
+    neighborOffsets cast = getFilmRecord(filmOffset).actors();
+    actorOffsets.insert(actorOffsets.end(), cast.begin(), cast.end());
+}
 
-    //iterate over the actors and insert them in the vector
-    for(int i = 0; i < actorsAmount; i++)
+/**the batch lookups' common core: decodes every requested record, in
+ * file order, and copies its neighbors into place in the arena.  The
+ * requests' file order is worked out in the arena itself, and moved to
+ * just past where the neighbors will go once their number is known, so
+ * that nothing but the two output vectors is ever allocated
+ * @param offsets: the requested records
+ * @param neighbors: the arena
+ * @param starts: set to where each request's neighbors begin, plus the arena's size
+ * @param areActors: whether offsets are actors' (whose films are gathered) or films'
+*/
+void imdb::gatherNeighbors(const vector<int>& offsets, vector<int>& neighbors, vector<int>& starts,
+                           bool areActors) const
+{
+    int requestAmount = offsets.size();
+    neighbors.resize(requestAmount);
+    for(int i = 0; i < requestAmount; i++)
+        neighbors[i] = i;
+    sort(neighbors.begin(), neighbors.end(), [&](int a, int b) { return offsets[a] < offsets[b]; });
+
+    //first pass: count every record's neighbors
+    starts.assign(requestAmount + 1, 0);
+    for(int i = 0; i < requestAmount; i++)
     {
-        int currActorOffset = *(int*)positionInInfo;
-        players.push_back(string((char*)actorFile + currActorOffset));
-        positionInInfo += 4;
+        int request = neighbors[i];
+        starts[request + 1] = areActors ? getActorRecord(offsets[request]).films().size()
+                                        : getFilmRecord(offsets[request]).actors().size();
     }
+    for(int i = 0; i < requestAmount; i++)
+        starts[i + 1] += starts[i];
 
-    return true;
+    //second pass: copy them in, still in file order, reading the order from past the end
+    int neighborAmount = starts[requestAmount];
+    neighbors.resize(neighborAmount + requestAmount);
+    if(neighborAmount > 0)
+        copy_backward(neighbors.begin(), neighbors.begin() + requestAmount, neighbors.end());
+    for(int i = 0; i < requestAmount; i++)
+    {
+        int request = neighbors[neighborAmount + i];
+        neighborOffsets list = areActors ? getActorRecord(offsets[request]).films()
+                                         : getFilmRecord(offsets[request]).actors();
+        copy(list.begin(), list.end(), neighbors.begin() + starts[request]);
+    }
+    neighbors.resize(neighborAmount);
 }
 
-imdb::~imdb()
+void imdb::getCreditOffsets(const vector<int>& actorOffsets, vector<int>& filmOffsets, vector<int>& starts) const
 {
-    releaseFileMap(actorInfo);
-    releaseFileMap(movieInfo);
+    gatherNeighbors(actorOffsets, filmOffsets, starts, true);
+}
+
+void imdb::getCastOffsets(const vector<int>& filmOffsets, vector<int>& actorOffsets, vector<int>& starts) const
+{
+    gatherNeighbors(filmOffsets, actorOffsets, starts, false);
 }
 
-// ignore everything below... it's all UNIXy stuff in place to make a file look like
-// an array of bytes in RAM.. 
-const void *imdb::acquireFileMap(const string& fileName, struct fileInfo& info)
+film imdb::getFilm(int filmOffset) const
 {
-    struct stat stats;
-    stat(fileName.c_str(), &stats);
-    info.fileSize = stats.st_size;
-    info.fd = open(fileName.c_str(), O_RDONLY);
-    return info.fileMap = mmap(0, info.fileSize, PROT_READ, MAP_SHARED, info.fd, 0);
+    filmRecord record = getFilmRecord(filmOffset);
+    film currFilm;
+    currFilm.title = string(record.name());
+    currFilm.year = record.year();
+    return currFilm;
+}
+
+bool imdb::getCredits(const string& player, vector<film>& films) const {
+    int actorOffset = getActorOffset(player);
+    //if the actor couldn't be found
+    if(actorOffset == -1)
+        return false;
+
+    //iterate over the films of the actor, inserting them in the vector
+    for(int filmOffset : getActorRecord(actorOffset).films())
+        films.push_back(getFilm(filmOffset));
+
+    return true;
+}
+
+bool imdb::getCast(const film& movie, vector<string>& players) const {
+    int filmOffset = getFilmOffset(movie);
+    //if the film can't be found
+    if(filmOffset == -1)
+        return false;
+
+    //iterate over the actors and insert them in the vector
+    for(int actorOffset : getFilmRecord(filmOffset).actors())
+        players.push_back(string(getActorRecord(actorOffset).name()));
+
+    return true;
 }
 
-void imdb::releaseFileMap(struct fileInfo& info)
+imdb::~imdb()
 {
-    if (info.fileMap != NULL) munmap((char *) info.fileMap, info.fileSize);
-    if (info.fd != -1) close(info.fd);
+    releaseFileMap(actorInfo);
+    releaseFileMap(movieInfo);
+    releaseFileMap(adjacencyInfo);
+    releaseFileMap(lookupInfo);
 }
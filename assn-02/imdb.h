@@ -2,10 +2,106 @@
 #define __imdb__
 
 #include "imdb-utils.h"
+#include "mappedfile.h"
 #include <string>
+#include <string_view>
 #include <vector>
+#include <mutex>
+#include <string.h>
+#include <stdint.h>
 using namespace std;
 
+/**
+ * Class: neighborOffsets
+ * ----------------------
+ * The array of offsets at the end of an actor or film record: the
+ * IDs of an actor's films, or of a film's cast.  It's a view straight
+ * into the mapped file, so it's only good for as long as the imdb it
+ * came from, and iterating over it (it's a range, so range-based for
+ * works) builds nothing.
+ */
+
+class neighborOffsets {
+ public:
+  neighborOffsets(const int *first, int count) : first(first), count(count) {}
+  const int *begin() const { return first; }
+  const int *end() const { return first + count; }
+  int size() const { return count; }
+  int operator[](int i) const { return first[i]; }
+
+  /**
+   * Method: decode
+   * --------------
+   * Finds the offsets at the end of a record whose name (and, for
+   * films, year) take up the first headerLength bytes.  Both kinds of
+   * record go on the same way: a \0 if needed to reach an even length,
+   * a short holding the number of offsets, two more \0's if needed to
+   * reach a multiple of four, and then the offsets themselves.
+   */
+
+  static neighborOffsets decode(const char *record, size_t headerLength)
+  {
+    headerLength += headerLength % 2;
+    int count = *(const short *) (record + headerLength);
+    headerLength += 2;
+    headerLength += headerLength % 4;
+    return neighborOffsets((const int *) (record + headerLength), count);
+  }
+
+ private:
+  const int *first;
+  int count;
+};
+
+/**
+ * Classes: actorRecord, filmRecord
+ * --------------------------------
+ * Zero-copy views of a single record, which decode it lazily: nothing is
+ * read until one of the accessors is called, and nothing the accessors
+ * return is a copy.  name() is the actor's name or the film's title,
+ * year() is the year a film was made, and films() and actors() are the
+ * record's neighbors.  Like neighborOffsets, a view is only good for as
+ * long as the imdb it came from (see imdb::getActorRecord).
+ */
+
+class actorRecord {
+ public:
+  actorRecord(const char *record) : record(record) {}
+  string_view name() const { return string_view(record); }
+  neighborOffsets films() const { return neighborOffsets::decode(record, strlen(record) + 1); }
+
+ private:
+  const char *record;
+};
+
+class filmRecord {
+ public:
+  filmRecord(const char *record) : record(record) {}
+  string_view name() const { return string_view(record); }
+  int year() const { return 1900 + (int) (signed char) record[strlen(record) + 1]; }
+  neighborOffsets actors() const { return neighborOffsets::decode(record, strlen(record) + 2); }
+
+ private:
+  const char *record;
+};
+
+/**
+ * Struct: dataSignature
+ * ---------------------
+ * Identifies the very actordata and moviedata an imdb was opened on.
+ * Files derived from them (the index files imdb-index writes, the tables
+ * imdb-hub writes) copy it into their headers and are ignored once it no
+ * longer matches.  Sizes alone miss an edit that keeps both files the
+ * same length, so the files' modification times and a hash of each
+ * offset table are part of it too.
+ */
+
+struct dataSignature {
+  int64_t actorFileSize, movieFileSize;
+  int64_t actorModified, movieModified;   // modification times, in nanoseconds
+  uint64_t actorHash, movieHash;          // 64-bit FNV-1a over each file's offset table
+};
+
 class imdb {
   
  public:
@@ -20,9 +116,10 @@ class imdb {
    * application (like six-degrees).
    *
    * @param directory the name of the directory housing the formatted information backing the imdb.
+   * @param policy how the data files (and any index files) are mapped; see mappingPolicy.
    */
 
-  imdb(const string& directory);
+  imdb(const string& directory, const mappingPolicy& policy = mappingPolicy());
 
   /**
    * Predicate Method: good
@@ -33,6 +130,7 @@ class imdb {
    *     1.) either one or both of the data files supporting the imdb were missing
    *     2.) the directory passed to the constructor doesn't exist.
    *     3.) the directory and files all exist, but you don't have the permission to read them.
+   *     4.) either file is too short, or its offset table leads outside of it.
    */
 
   bool good() const;
@@ -74,6 +172,187 @@ class imdb {
 
   bool getCast(const film& movie, vector<string>& players) const;
 
+  /**
+   * Methods: getActorOffset, getFilmOffset
+   * --------------------------------------
+   * Every actor and film is identified by the byte offset of its record
+   * within its data file, which is a perfectly good 32-bit ID: it's unique,
+   * it never changes, and getting from it to the record is a single addition.
+   * These two methods look up the ID of the specified actor or film, so that
+   * a search can be run entirely on IDs (see getCreditOffsets and
+   * getCastOffsets) and names only built for whatever gets printed.
+   *
+   * If the data directory holds a current lookup index (see
+   * writeLookupIndex), the constructor maps it, and each lookup is a probe
+   * into a hash table; otherwise it's a binary search over the names.
+   *
+   * @return the offset of the actor's (or film's) record, or -1 if it
+   *         doesn't appear in the database.
+   */
+
+  int getActorOffset(const string& player) const;
+  int getFilmOffset(const film& movie) const;
+
+  /**
+   * Method: getCreditOffsets
+   * ------------------------
+   * Appends the IDs (moviedata offsets) of the specified actor's films
+   * to filmOffsets.  No strings are built.
+   *
+   * @param actorOffset the ID of an actor, as returned by getActorOffset
+   *                    or getCastOffsets.
+   * @param filmOffsets the vector the IDs of the actor's films are appended to.
+   */
+
+  void getCreditOffsets(int actorOffset, vector<int>& filmOffsets) const;
+
+  /**
+   * Method: getCastOffsets
+   * ----------------------
+   * Appends the IDs (actordata offsets) of the specified film's cast
+   * to actorOffsets.  No strings are built.
+   *
+   * @param filmOffset the ID of a film, as returned by getFilmOffset
+   *                   or getCreditOffsets.
+   * @param actorOffsets the vector the IDs of the film's cast are appended to.
+   */
+
+  void getCastOffsets(int filmOffset, vector<int>& actorOffsets) const;
+
+  /**
+   * Methods: getCreditOffsets, getCastOffsets (batch versions)
+   * ----------------------------------------------------------
+   * Look up the films of many actors (or the casts of many films) at once.
+   * The results for every request are laid out back to back in the first
+   * output vector, with the results for request i running from index
+   * starts[i] up to starts[i + 1], so starts ends up one longer than the
+   * list of requests.  Both output vectors are overwritten rather than
+   * appended to, and a caller that passes the same two vectors to each batch
+   * stops allocating once they've grown large enough.  The records are
+   * read in file order, whatever order the requests come in.
+   *
+   * @param actorOffsets (or filmOffsets) the IDs of the actors (or films) of interest.
+   * @param filmOffsets (or actorOffsets) the arena the IDs of their films (casts) are written to.
+   * @param starts where each request's results begin in the arena.
+   */
+
+  void getCreditOffsets(const vector<int>& actorOffsets, vector<int>& filmOffsets, vector<int>& starts) const;
+  void getCastOffsets(const vector<int>& filmOffsets, vector<int>& actorOffsets, vector<int>& starts) const;
+
+  /**
+   * Methods: getActorName, getFilm
+   * ------------------------------
+   * Materialize the actor or film with the specified ID.  getActorName
+   * returns a pointer straight into the mapped file, which stays valid
+   * for as long as the imdb does.
+   */
+
+  const char *getActorName(int actorOffset) const { return (const char *) actorFile + actorOffset; }
+  film getFilm(int filmOffset) const;
+
+  /**
+   * Methods: getActorRecord, getFilmRecord
+   * --------------------------------------
+   * Return views of the records with the specified IDs (see actorRecord
+   * and filmRecord), for reading names, years, and neighbors straight
+   * out of the mapped files.
+   */
+
+  actorRecord getActorRecord(int actorOffset) const { return actorRecord((const char *) actorFile + actorOffset); }
+  filmRecord getFilmRecord(int filmOffset) const { return filmRecord((const char *) movieFile + filmOffset); }
+
+  /**
+   * Methods: getNumActors, getNumFilms, getActorOrdinal, getFilmOrdinal
+   * -------------------------------------------------------------------
+   * Every actor and film also has an ordinal: its position in its data
+   * file's table of offsets, which runs from 0 up to (but not including)
+   * getNumActors() or getNumFilms().  Ordinals are dense, so they can index
+   * plain arrays and bitsets, where offsets would leave gaps.  Converting
+   * an offset to an ordinal is a single array lookup, and getActorOffsetAt
+   * and getFilmOffsetAt go the other way.  The array behind each direction
+   * holds an int for every four bytes of its data file, so it isn't built
+   * until the first call that needs it (which is safe from any number of
+   * threads at once).
+   */
+
+  int getNumActors() const { return good() ? *(const int *) actorFile : 0; }
+  int getNumFilms() const { return good() ? *(const int *) movieFile : 0; }
+  int getActorOrdinal(int actorOffset) const { return getActorOrdinals()[actorOffset / 4]; }
+  int getFilmOrdinal(int filmOffset) const { return getFilmOrdinals()[filmOffset / 4]; }
+  int getActorOffsetAt(int actorOrdinal) const { return ((const int *) actorFile)[actorOrdinal + 1]; }
+  int getFilmOffsetAt(int filmOrdinal) const { return ((const int *) movieFile)[filmOrdinal + 1]; }
+
+  /**
+   * Methods: getSignature, getMappingPolicy
+   * ---------------------------------------
+   * Return the signature of the two data files, which is computed
+   * once, when the imdb is constructed, and the policy the imdb maps
+   * its files with, which files derived from the data (like the tables
+   * imdb-hub writes) are mapped with too.
+   */
+
+  const dataSignature& getSignature() const { return signature; }
+  const mappingPolicy& getMappingPolicy() const { return policy; }
+
+  /**
+   * Method: loadAdjacencyIndex
+   * --------------------------
+   * Readies the adjacency index, which records the actor/film graph
+   * in compressed sparse row form: for every actor, the ordinals of its
+   * films, and for every film, the ordinals of its cast, each list stored
+   * contiguously in one big int array.  The index is mapped from the
+   * "adjacency" file written by imdb-index if the data directory has one
+   * that matches actordata and moviedata, and otherwise it's built in
+   * memory, which takes a pass over both data files.
+   *
+   * @return true if the index was mapped from its file, and false
+   *         if it had to be built.
+   */
+
+  bool loadAdjacencyIndex();
+
+  /**
+   * Method: writeAdjacencyIndex
+   * ---------------------------
+   * Builds the adjacency index and saves it to the specified file,
+   * where loadAdjacencyIndex will look for it if the file is named
+   * "adjacency" and placed in the data directory.
+   *
+   * @return true if and only if the file was written in full.
+   */
+
+  bool writeAdjacencyIndex(const string& fileName) const;
+
+  /**
+   * Method: writeLookupIndex
+   * ------------------------
+   * Builds hash tables from actor names and from (title, year) pairs to
+   * record offsets and saves them to the specified file.  If the file is
+   * named "lookup" and placed in the data directory, later imdbs opened on
+   * that directory map it and answer getActorOffset and getFilmOffset
+   * (and so getCredits and getCast) with a hash probe instead of a binary
+   * search.  hasLookupIndex reports whether this imdb is using one.
+   *
+   * @return true if and only if the file was written in full.
+   */
+
+  bool writeLookupIndex(const string& fileName) const;
+  bool hasLookupIndex() const { return actorSlots != NULL; }
+
+  /**
+   * Methods: getCreditOrdinals, getCastOrdinals
+   * -------------------------------------------
+   * Return the ordinals of the specified actor's films (or of the
+   * specified film's cast) as a pointer to a contiguous run of ints
+   * inside the adjacency index, whose length is placed in the second
+   * argument.  loadAdjacencyIndex must have been called first.
+   */
+
+  const int *getCreditOrdinals(int actorOrdinal, int& numCredits) const
+    { numCredits = creditStarts[actorOrdinal + 1] - creditStarts[actorOrdinal]; return credits + creditStarts[actorOrdinal]; }
+  const int *getCastOrdinals(int filmOrdinal, int& numActors) const
+    { numActors = castStarts[filmOrdinal + 1] - castStarts[filmOrdinal]; return cast + castStarts[filmOrdinal]; }
+
   /**
    * Destructor: ~imdb
    * -----------------
@@ -86,6 +365,8 @@ class imdb {
  private:
   static const char *const kActorFileName;
   static const char *const kMovieFileName;
+  static const char *const kAdjacencyFileName;
+  static const char *const kLookupFileName;
   const void *actorFile;
   const void *movieFile;
 
@@ -102,19 +383,57 @@ class imdb {
   
   // everything below here is complicated and needn't be touched.
   // you're free to investigate, but you're on your own.
-  struct fileInfo {
-    int fd;
-    size_t fileSize;
-    const void *fileMap;
-  } actorInfo, movieInfo;
-  
-  static const void *acquireFileMap(const string& fileName, struct fileInfo& info);
-  static void releaseFileMap(struct fileInfo& info);
+  struct fileInfo actorInfo, movieInfo;
+  dataSignature signature;
+  mappingPolicy policy;
+
+  //ordinal of the record starting at every 4-byte boundary of each file (every
+  //record is 4-byte aligned), built the first time it's asked for
+  mutable vector<int> actorOrdinals, filmOrdinals;
+  mutable once_flag actorOrdinalsBuilt, filmOrdinalsBuilt;
+  const int *getActorOrdinals() const;
+  const int *getFilmOrdinals() const;
+  static bool isValidOffsetTable(const void *file, size_t fileSize);
+  static uint64_t hashOffsetTable(const void *file);
+  static void buildOrdinals(const void *file, size_t fileSize, vector<int>& ordinals);
+
+  //the adjacency index, either mapped from its file or built into adjacencyImage;
+  //the four pointers lead into whichever one it is
+  string adjacencyFileName;
+  struct fileInfo adjacencyInfo;
+  vector<int> adjacencyImage;
+  const int *creditStarts, *credits, *castStarts, *cast;
+  void buildAdjacencyImage(vector<int>& image) const;
+  bool isValidAdjacencyImage(const int *image, size_t imageSize) const;
+  void useAdjacencyImage(const int *image);
+
+  //the lookup index: two open-addressing hash tables, mapped from the lookup
+  //file, whose sizes are powers of two.  A slot holds the full hash of its
+  //key and the index of the key's entry in its data file's offset table,
+  //which is one more than its ordinal, or 0 if it's empty (the record count
+  //sits where entry 0 would)
+  struct lookupSlot {
+    unsigned hash;
+    int entry;
+  };
+  struct fileInfo lookupInfo;
+  const lookupSlot *actorSlots, *filmSlots;
+  unsigned actorSlotMask, filmSlotMask;
+  void loadLookupIndex(const string& fileName);
+  static bool isValidLookupSlots(const lookupSlot *slots, unsigned numSlots, int numRecords);
+  static unsigned hashActor(const char *name, size_t length);
+  static unsigned hashFilm(const char *title, size_t length, char year);
+  int findActorSlot(const char *name, size_t length) const;
+  int findFilmSlot(const char *title, size_t length, char year) const;
+  static void fillLookupSlots(lookupSlot *slots, unsigned numSlots, const void *file, bool isActorFile);
   
   //comparison functions to use for bsearch
   static int namesCmp(const void* one, const void* two);
   static int filmsCmp(const void* one, const void* two);
 
+  void gatherNeighbors(const vector<int>& offsets, vector<int>& neighbors, vector<int>& starts,
+                       bool areActors) const;
+
   // marked as private so imdbs can't be copy constructed or reassigned.
   // if we were to allow this, we'd alias open files and accidentally close
   // files prematurely.. (do NOT implement these... since the client will
@@ -0,0 +1,103 @@
+/**
+ * File: mappedfile.cc
+ * -------------------
+ * It's all UNIXy stuff in place to make a file look like an array
+ * of bytes in RAM.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include "mappedfile.h"
+using namespace std;
+
+const char *const kMappingUsage = "[--prefault] [--advise random|willneed] [--hugepages] [--mlock]";
+
+bool parseMappingOption(int argc, const char *const argv[], int& i, mappingPolicy& policy)
+{
+    if(strcmp(argv[i], "--prefault") == 0)
+        policy.prefault = true;
+    else if(strcmp(argv[i], "--hugepages") == 0)
+        policy.hugePages = true;
+    else if(strcmp(argv[i], "--mlock") == 0)
+        policy.lock = true;
+    else if(strcmp(argv[i], "--advise") == 0 && i + 1 < argc && strcmp(argv[i + 1], "random") == 0)
+        policy.advice = kAdviseRandom, i++;
+    else if(strcmp(argv[i], "--advise") == 0 && i + 1 < argc && strcmp(argv[i + 1], "willneed") == 0)
+        policy.advice = kAdviseWillNeed, i++;
+    else
+        return false;
+    return true;
+}
+
+/**advice, huge page hints, and locking are only requests, so their failures
+ * are shrugged off
+*/
+const void *acquireFileMap(const string& fileName, fileInfo& info, const mappingPolicy& policy)
+{
+    info.fd = -1;
+    info.fileMap = NULL;
+    info.fileSize = 0;
+    info.modified = 0;
+    info.fd = open(fileName.c_str(), O_RDONLY);
+    if(info.fd == -1)
+        return NULL;
+    struct stat stats;
+    if(fstat(info.fd, &stats) != 0 || stats.st_size < (off_t)sizeof(int))
+    {
+        releaseFileMap(info);
+        return NULL;
+    }
+    info.fileSize = stats.st_size;
+    info.modified = stats.st_mtim.tv_sec * (int64_t)1000000000 + stats.st_mtim.tv_nsec;
+
+    int flags = MAP_SHARED;
+    if(policy.prefault)
+        flags |= MAP_POPULATE;
+    void *map = mmap(0, info.fileSize, PROT_READ, flags, info.fd, 0);
+    if(map == MAP_FAILED)
+    {
+        releaseFileMap(info);
+        return NULL;
+    }
+
+    if(policy.advice == kAdviseRandom)
+        madvise(map, info.fileSize, MADV_RANDOM);
+    else if(policy.advice == kAdviseWillNeed)
+        madvise(map, info.fileSize, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+    if(policy.hugePages)
+        madvise(map, info.fileSize, MADV_HUGEPAGE);     //only honored where the kernel backs file mappings with huge pages
+#endif
+    if(policy.lock)
+        mlock(map, info.fileSize);
+    return info.fileMap = map;
+}
+
+bool writeIndexFile(const string& fileName, const void *data, size_t size)
+{
+    const string tempFileName = fileName + ".tmp";
+    FILE *file = fopen(tempFileName.c_str(), "wb");
+    if(file == NULL)
+        return false;
+    bool written = fwrite(data, 1, size, file) == size;
+    written = (fclose(file) == 0) && written;
+    if(!written || rename(tempFileName.c_str(), fileName.c_str()) != 0)
+    {
+        remove(tempFileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+void releaseFileMap(fileInfo& info)
+{
+    if (info.fileMap != NULL) munmap((char *) info.fileMap, info.fileSize);
+    if (info.fd != -1) close(info.fd);
+    info.fileMap = NULL;
+    info.fd = -1;
+}
@@ -0,0 +1,111 @@
+#ifndef __mappedfile__
+#define __mappedfile__
+
+/**
+ * File: mappedfile.h
+ * ------------------
+ * Maps whole files read-only into memory and writes the files that
+ * get mapped later on.  The imdb maps its data and index files this
+ * way, and the hubTable maps the tables imdb-hub writes, so every
+ * file follows the same mappingPolicy.
+ */
+
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Struct: mappingPolicy
+ * ---------------------
+ * Says how files are mapped into memory, which decides who pays
+ * for reading them in from disk and when.  By default nothing is read
+ * until it's touched, so the first queries pay for their page faults.
+ *
+ *     prefault    map with MAP_POPULATE, so that every page is read in
+ *                 (in one long sequential pass) before acquireFileMap returns.
+ *     advice      kAdviseRandom turns off readahead, which is wasted on
+ *                 lookups that jump around; kAdviseWillNeed starts reading
+ *                 the whole file in the background right away.
+ *     hugePages   asks for transparent huge pages, which cut TLB misses on
+ *                 kernels that back file mappings with them.
+ *     lock        mlocks the mappings, so they're never paged back out
+ *                 (subject to RLIMIT_MEMLOCK).
+ *
+ * Advice, huge pages, and locking are requests: if the kernel refuses
+ * one, the file is mapped just the same without it.
+ */
+
+enum mappingAdvice { kAdviseNormal, kAdviseRandom, kAdviseWillNeed };
+
+struct mappingPolicy {
+  bool prefault = false;
+  mappingAdvice advice = kAdviseNormal;
+  bool hugePages = false;
+  bool lock = false;
+};
+
+/**
+ * Function: parseMappingOption
+ * ----------------------------
+ * Reads one of the mapping options every program here accepts
+ * (--prefault, --advise random|willneed, --hugepages, --mlock) into
+ * policy, if argv[i] is one, and moves i onto its last argument.
+ * kMappingUsage spells the options out for usage messages.
+ *
+ * @return true if and only if argv[i] was a mapping option.
+ */
+
+bool parseMappingOption(int argc, const char *const argv[], int& i, mappingPolicy& policy);
+
+extern const char *const kMappingUsage;
+
+/**
+ * Struct: fileInfo
+ * ----------------
+ * Everything needed to use, and later release, one mapped file.
+ * An unused fileInfo has an fd of -1 and a NULL fileMap.
+ */
+
+struct fileInfo {
+  int fd;
+  size_t fileSize;
+  int64_t modified;     // st_mtim, in nanoseconds
+  const void *fileMap;
+};
+
+/**
+ * Function: acquireFileMap
+ * ------------------------
+ * Maps the whole of the specified file read-only, following the
+ * specified policy, and fills in info.
+ *
+ * @return the mapped file, or NULL (with info marked unused) if the file
+ *         doesn't exist, can't be opened, is smaller than an int, or can't
+ *         be mapped.
+ */
+
+const void *acquireFileMap(const string& fileName, fileInfo& info, const mappingPolicy& policy);
+
+/**
+ * Function: releaseFileMap
+ * ------------------------
+ * Unmaps and closes whatever info holds, and marks it unused.
+ * Releasing an unused fileInfo does nothing.
+ */
+
+void releaseFileMap(fileInfo& info);
+
+/**
+ * Function: writeIndexFile
+ * ------------------------
+ * Writes size bytes to the specified file by way of a temporary file
+ * next to it that's renamed into place, so that a reader never maps
+ * half of one.
+ *
+ * @return true if and only if the whole file was written.
+ */
+
+bool writeIndexFile(const string& fileName, const void *data, size_t size);
+
+#endif
@@ -1,11 +1,19 @@
 #include <vector>
-#include <queue>
-#include <set>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
 #include <string>
 #include <iostream>
 #include <iomanip>
 #include "imdb.h"
 #include "path.h"
+#include "hubtable.h"
 using namespace std;
 
 /**
@@ -30,84 +38,681 @@ static string promptForActor(const string& prompt, const imdb& db)
     cout << prompt << " [or <enter> to quit]: ";
     getline(cin, response);
     if (response == "") return "";
-    vector<film> credits;
-    if (db.getCredits(response, credits)) return response;
+    if (db.getActorOffset(response) != -1) return response;
     cout << "We couldn't find \"" << response << "\" in the movie database. "
 	 << "Please try again." << endl;
   }
 }
 
-void generateShortestPath(string& start, string& dest, imdb& db)
+static const int kMaxPathLength = 6;
+
+/**
+ * A visited set over the ordinals 0 through size - 1 (see
+ * imdb::getActorOrdinal).  An element is in the set if its stamp matches
+ * the current epoch, so emptying the set for the next query is just a
+ * matter of moving to a new epoch; the array itself is only ever wiped
+ * when the epoch counter wraps around.  Stamps are read and written
+ * atomically so that the threads expanding one level can all claim
+ * ordinals at once: of any number of threads claiming the same ordinal,
+ * exactly one is told it was new.  A single thread uses insert, which
+ * skips the (much dearer) atomic exchange.  The stamps are plain
+ * unsigneds accessed through GCC's __atomic builtins, which, unlike
+ * std::atomic's member functions, stay single instructions in the
+ * unoptimized builds this Makefile makes.
+ */
+
+struct visitMarks {
+    vector<unsigned> stamps;
+    unsigned epoch;
+
+    visitMarks(int size) : stamps(size, 0), epoch(1) {}
+
+    void clear()
+    {
+        if(++epoch != 0) return;
+        fill(stamps.begin(), stamps.end(), 0);
+        epoch = 1;
+    }
+
+    bool contains(int ordinal) const { return __atomic_load_n(&stamps[ordinal], __ATOMIC_RELAXED) == epoch; }
+
+    //adds the ordinal and returns true, or returns false if it was already there
+    bool insert(int ordinal)
+    {
+        if(contains(ordinal)) return false;
+        stamps[ordinal] = epoch;
+        return true;
+    }
+
+    //insert, for when other threads may be inserting too
+    bool claim(int ordinal)
+    {
+        if(contains(ordinal)) return false;     //cheap test before the exchange
+        return __atomic_exchange_n(&stamps[ordinal], epoch, __ATOMIC_RELAXED) != epoch;
+    }
+};
+
+/**
+ * Everything a search remembers about one actor it has reached:
+ * the actor, the film it was reached through (both as ordinals), and
+ * the index of the record for the actor it was reached from.  A side's root has no
+ * film and no parent, so both of those are -1.
+ */
+
+struct predecessor {
+    int actor;
+    int film;
+    int parent;
+
+    predecessor(int actor, int film, int parent) : actor(actor), film(film), parent(parent) {}
+};
+
+/**
+ * One half of a bidirectional search.  records holds one predecessor
+ * per actor the side has reached, in the order they were reached, so
+ * the records making up the current frontier are simply the ones at
+ * index levelStart and beyond, and any actor's path back to the root
+ * is a chain of parent indices.  Nothing but those three ints is kept
+ * per actor, and no partial path is ever copied.  recordIndex maps a
+ * reached actor's ordinal to its record.  Whether an actor or film
+ * has been seen is tracked by ordinal, and the marks and arrays are
+ * kept from one query to the next (see reset).  Actors and films are
+ * identified by ordinal throughout, since that's what the adjacency
+ * index (see imdb::loadAdjacencyIndex) is expressed in.
+ */
+
+struct searchSide {
+    const imdb& db;
+    visitMarks seenActors;
+    visitMarks seenFilms;
+    vector<int> recordIndex;    //only meaningful for ordinals in seenActors
+    vector<predecessor> records;
+    int levelStart;
+    int depth;
+
+    searchSide(const imdb& db) :
+        db(db), seenActors(db.getNumActors()), seenFilms(db.getNumFilms()),
+        recordIndex(db.getNumActors()), levelStart(0), depth(0) {}
+
+    //starts a new search from root, forgetting everything about the last one
+    void reset(int root)
+    {
+        seenActors.clear();
+        seenFilms.clear();
+        records.clear();
+        levelStart = 0;
+        depth = 0;
+        seenActors.insert(root);
+        reach(root, -1, -1);
+    }
+
+    int getFrontierSize() const { return records.size() - levelStart; }
+
+    //records that actor, already in seenActors, was reached through film from the actor in records[parent]
+    void reach(int actor, int film, int parent)
+    {
+        recordIndex[actor] = records.size();
+        records.push_back(predecessor(actor, film, parent));
+    }
+};
+
+/**
+ * Counts the films between the specified record
+ * and the side's root.
+ */
+
+static int pathLengthToRoot(const searchSide& side, int record)
+{
+    int length = 0;
+    while((record = side.records[record].parent) != -1)
+        length++;
+    return length;
+}
+
+/**
+ * Follows the side's parent links from the specified record back to
+ * the side's root, adding each film and actor along the way to p.
+ */
+
+static void appendPathToRoot(path& p, const searchSide& side, int record, const imdb& db)
+{
+    while(side.records[record].parent != -1)
+    {
+        const predecessor& curr = side.records[record];
+        record = curr.parent;
+        p.addConnection(db.getFilm(db.getFilmOffsetAt(curr.film)),
+                        db.getActorName(db.getActorOffsetAt(side.records[record].actor)));
+    }
+}
+
+/**
+ * What one thread expanding a level has found: the actors it claimed,
+ * in the order it claimed them, and the best meeting point among them.
+ */
+
+struct levelPart {
+    vector<predecessor> reached;
+    int best;
+    int meeting;
+};
+
+/**
+ * Expands the frontier records handed out by next, kChunkSize at a
+ * time, until there are none left.  Films and actors are claimed in the
+ * side's (shared) marks, and the actors this thread claims are collected
+ * in part, along with the best meeting point among them.  shared says
+ * whether other threads are expanding the same level; if none are, the
+ * actors are recorded in the side directly instead.
+ */
+
+static const int kChunkSize = 64;
+
+static void expandChunks(searchSide& side, const searchSide& other, const imdb& db,
+                         atomic<int>& next, int levelEnd, bool shared, levelPart& part)
+{
+    part.reached.clear();
+    part.best = INT_MAX;
+    int begin;
+    while((begin = next.fetch_add(kChunkSize, memory_order_relaxed)) < levelEnd)
+    {
+        int end = min(begin + kChunkSize, levelEnd);
+        for(int i = begin; i < end; i++)
+        {
+            int filmAmount;
+            const int *films = db.getCreditOrdinals(side.records[i].actor, filmAmount);
+            for(int j = 0; j < filmAmount; j++)
+            {
+                int currentFilm = films[j];
+                bool isNew = shared ? side.seenFilms.claim(currentFilm) : side.seenFilms.insert(currentFilm);
+                if(!isNew) continue;     //every costar it leads to is already known
+                int actorsAmount;
+                const int *cast = db.getCastOrdinals(currentFilm, actorsAmount);
+                for(int k = 0; k < actorsAmount; k++)
+                {
+                    int actor = cast[k];
+                    if(!(shared ? side.seenActors.claim(actor) : side.seenActors.insert(actor))) continue;
+                    if(shared) part.reached.push_back(predecessor(actor, currentFilm, i));
+                    else side.reach(actor, currentFilm, i);
+                    if(!other.seenActors.contains(actor)) continue;
+                    int length = side.depth + 1 + pathLengthToRoot(other, other.recordIndex[actor]);
+                    if(length < part.best)
+                    {
+                        part.best = length;
+                        part.meeting = actor;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * The threads that expand large levels, started once and kept waiting
+ * between levels, so that a level costs a wakeup rather than a thread
+ * creation per helper.  parts holds one levelPart per thread, the
+ * caller's first, kept so that their vectors are reused.  expand hands
+ * a level to the first numThreads threads (the calling one included),
+ * expands its own share, and returns once the helpers have finished
+ * theirs.
+ */
+
+struct levelWorkers {
+    vector<levelPart> parts;
+    vector<thread> helpers;
+    mutex lock;
+    condition_variable wake, finished;
+    unsigned round;         //counts the levels handed out, so helpers can tell a new one from the last
+    int numWanted;          //threads expanding the current level, caller included
+    int numBusy;            //helpers still expanding it
+    bool stopping;
+    searchSide *side;       //the current level, which stays put until numBusy drops to 0
+    const searchSide *other;
+    const imdb *db;
+    atomic<int> next;
+    int levelEnd;
+
+    levelWorkers(int numThreads) : parts(numThreads), round(0), numWanted(1), numBusy(0), stopping(false)
+    {
+        for(int t = 1; t < numThreads; t++)
+            helpers.push_back(thread(&levelWorkers::help, this, t));
+    }
+
+    ~levelWorkers()
+    {
+        {
+            lock_guard<mutex> hold(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(int t = 0; t < (int) helpers.size(); t++)
+            helpers[t].join();
+    }
+
+    int size() const { return parts.size(); }
+
+    //expands the records from side.levelStart up to end, on numThreads threads
+    void expand(searchSide& levelSide, const searchSide& otherSide, const imdb& levelDb, int end, int numThreads)
+    {
+        next.store(levelSide.levelStart, memory_order_relaxed);
+        if(numThreads > 1)
+        {
+            {
+                lock_guard<mutex> hold(lock);
+                side = &levelSide;
+                other = &otherSide;
+                db = &levelDb;
+                levelEnd = end;
+                numWanted = numThreads;
+                numBusy = numThreads - 1;
+                round++;
+            }
+            wake.notify_all();
+        }
+        expandChunks(levelSide, otherSide, levelDb, next, end, numThreads > 1, parts[0]);
+        if(numThreads > 1)
+        {
+            unique_lock<mutex> hold(lock);
+            finished.wait(hold, [this] { return numBusy == 0; });
+        }
+    }
+
+    //the body of helper t: waits for a level, expands its share if it's wanted, and waits again
+    void help(int t)
+    {
+        unsigned seen = 0;
+        unique_lock<mutex> hold(lock);
+        while(true)
+        {
+            wake.wait(hold, [&] { return stopping || round != seen; });
+            if(stopping) return;
+            seen = round;
+            if(t >= numWanted) continue;
+            hold.unlock();
+            expandChunks(*side, *other, *db, next, levelEnd, true, parts[t]);
+            hold.lock();
+            if(--numBusy == 0) finished.notify_one();
+        }
+    }
+};
+
+/**
+ * Expands every actor on the side's frontier by one level.  Each
+ * newly reached actor that the other side has already reached is a
+ * meeting point, and the one making for the shortest total path is
+ * recorded in meeting.  Neighbors are read straight out of the
+ * adjacency index, one contiguous run of ordinals per actor or film.
+ * The level is always finished, because the first meeting found needn't
+ * be the best one.
+ *
+ * Large frontiers are split among the workers' threads, which hand
+ * out chunks of it through one atomic counter and each collect what
+ * they reach on their own; their findings are appended to the records
+ * once they've all finished, so no lock is held while expanding.  When several
+ * threads reach the same actor in the same level, whichever claims it
+ * first becomes its predecessor, so the path printed can vary from run
+ * to run, although its length can't.  Small frontiers (and every
+ * frontier, given one thread) are expanded on the calling thread alone,
+ * in frontier order.
+ *
+ * @return the length of the shortest path through a meeting point,
+ *         or INT_MAX if the sides haven't met.
+ */
+
+static const int kMinRecordsPerThread = 256;
+
+static int expandLevel(searchSide& side, const searchSide& other, const imdb& db, levelWorkers& workers,
+                       int& meeting)
 {
-    queue<path> partialPaths;
-    set<string> previouslySeenActors;
-    set<film> previouslySeenFilms;
+    int levelEnd = side.records.size();
+    int numThreads = min(workers.size(), max(1, (levelEnd - side.levelStart) / kMinRecordsPerThread));
+    workers.expand(side, other, db, levelEnd, numThreads);
 
-    partialPaths.push(path(start));
+    int best = INT_MAX;
+    for(int t = 0; t < numThreads; t++)
+    {
+        const levelPart& part = workers.parts[t];
+        for(int i = 0; i < (int) part.reached.size(); i++)
+            side.reach(part.reached[i].actor, part.reached[i].film, part.reached[i].parent);
+        if(part.best < best)
+        {
+            best = part.best;
+            meeting = part.meeting;
+        }
+    }
+    side.levelStart = levelEnd;
+    side.depth++;
+    return best;
+}
+
+/**
+ * Answers a query one of whose actors is the hub of the specified table
+ * by following the table's parent links from the other actor back to the
+ * hub, which takes no search at all.  The path is built from the
+ * non-hub end and reversed if the hub is start.
+ *
+ * @return false if neither actor is the hub, and true once the query
+ *         has been answered.
+ */
 
-    while(!partialPaths.empty() && partialPaths.front().getLength() < 6)
+static bool answerFromHub(int start, int dest, const hubTable& hub, const imdb& db)
+{
+    if(!hub.good() || (start != hub.getHub() && dest != hub.getHub()))
+        return false;
+
+    int other = start == hub.getHub() ? dest : start;
+    if(hub.getDistance(other) == -1 || hub.getDistance(other) > kMaxPathLength)
     {
-        path firstPath = partialPaths.front();
-        partialPaths.pop();
-        vector<film> films;
-        db.getCredits(firstPath.getLastPlayer(), films);
-        //iterate over the films that the last actor in the first path has acted in
-        for(int i = 0, filmAmount = films.size(); i < filmAmount; i++)
+        cout << "No path between those two people could be found." << endl;
+        return true;
+    }
+
+    path result(db.getActorName(db.getActorOffsetAt(other)));
+    for(int actor = other; actor != hub.getHub(); actor = hub.getParent(actor))
+        result.addConnection(db.getFilm(db.getFilmOffsetAt(hub.getFilm(actor))),
+                             db.getActorName(db.getActorOffsetAt(hub.getParent(actor))));
+    if(other == dest)
+        result.reverse();
+    cout << result << endl;
+    return true;
+}
+
+/**
+ * Bidirectional breadth-first search over actor and film ordinals
+ * (see imdb::getActorOrdinal).  The two sides take turns, level
+ * by level, with whichever frontier is smaller expanding next, until
+ * they meet or until no path short enough could remain.  The path is
+ * then assembled from the two sides' predecessor records: from the meeting
+ * point back to start, reversed, and then on from the meeting point
+ * to dest.  Names are only ever materialized for that one path.  Queries
+ * involving the hub actor are answered from the hub table instead, if
+ * one is loaded.  The two sides and the workers are the caller's, so
+ * that one set can be reused by every query against db.
+ */
+
+void generateShortestPath(string& start, string& dest, const imdb& db, searchSide& fromStart, searchSide& fromDest,
+                          levelWorkers& workers, const hubTable& hub)
+{
+    int startActor = db.getActorOrdinal(db.getActorOffset(start));
+    int destActor = db.getActorOrdinal(db.getActorOffset(dest));
+    if(answerFromHub(startActor, destActor, hub, db))
+        return;
+
+    fromStart.reset(startActor);
+    fromDest.reset(destActor);
+    int meeting = -1;
+    int length = INT_MAX;
+
+    while(length == INT_MAX && fromStart.depth + fromDest.depth < kMaxPathLength &&
+          fromStart.getFrontierSize() > 0 && fromDest.getFrontierSize() > 0)
+    {
+        if(fromStart.getFrontierSize() <= fromDest.getFrontierSize())
+            length = expandLevel(fromStart, fromDest, db, workers, meeting);
+        else
+            length = expandLevel(fromDest, fromStart, db, workers, meeting);
+    }
+
+    if(length > kMaxPathLength)
+    {
+        cout << "No path between those two people could be found." << endl;
+        return;
+    }
+
+    int startRecord = fromStart.recordIndex[meeting];
+    path result(db.getActorName(db.getActorOffsetAt(fromStart.records[startRecord].actor)));
+    appendPathToRoot(result, fromStart, startRecord, db);
+    result.reverse();
+    appendPathToRoot(result, fromDest, fromDest.recordIndex[meeting], db);
+    cout << result << endl;
+}
+
+/**
+ * One line of a pairs file, once its names have been looked up.
+ */
+
+struct pairQuery {
+    int source;     //actor ordinals
+    int target;
+    string sourceName;
+    string targetName;
+};
+
+/**
+ * A breadth-first search from one source that stops as soon as every
+ * actor it's been asked about has been reached.  distances[a] is only
+ * meaningful for ordinals a in seenActors.  Like searchSide, it's kept
+ * from one search to the next, and each worker thread has its own.
+ */
+
+struct distanceSearch {
+    const imdb& db;
+    visitMarks seenActors;
+    visitMarks seenFilms;
+    visitMarks wanted;
+    vector<int> distances;
+    vector<int> frontier, next;
+
+    distanceSearch(const imdb& db) :
+        db(db), seenActors(db.getNumActors()), seenFilms(db.getNumFilms()),
+        wanted(db.getNumActors()), distances(db.getNumActors()) {}
+
+    //searches from source until every target has been reached or no actor is left to reach
+    void run(int source, const vector<int>& targets)
+    {
+        seenActors.clear();
+        seenFilms.clear();
+        wanted.clear();
+        int remaining = 0;
+        for(int i = 0; i < (int) targets.size(); i++)
+            if(wanted.insert(targets[i])) remaining++;
+
+        seenActors.insert(source);
+        distances[source] = 0;
+        if(wanted.contains(source)) remaining--;
+        frontier.assign(1, source);
+        for(int depth = 1; remaining > 0 && !frontier.empty(); depth++)
         {
-            film currentFilm = films[i];
-            if(previouslySeenFilms.find(currentFilm) == previouslySeenFilms.end())
-            {//if we haven't seen the film yet
-                previouslySeenFilms.insert(currentFilm);
-                vector<string> castForCurrFilm;
-                db.getCast(currentFilm, castForCurrFilm);
-                
-                //iterate over the current film's cast
-                for(int i = 0, actorAmount = castForCurrFilm.size(); i < actorAmount; i++)
+            next.clear();
+            for(int i = 0; i < (int) frontier.size() && remaining > 0; i++)
+            {
+                int filmAmount;
+                const int *films = db.getCreditOrdinals(frontier[i], filmAmount);
+                for(int j = 0; j < filmAmount; j++)
                 {
-                    string currentActor = castForCurrFilm[i];
-                    if(previouslySeenActors.find(currentActor) == previouslySeenActors.end())
-                    {//if we haven't seen the current actor yet
-                        previouslySeenActors.insert(currentActor);
-                        path clonePath = path(firstPath);
-                        clonePath.addConnection(currentFilm, currentActor);
-                        //if we have reached the destination
-                        if(currentActor == dest)
-                        {
-                            cout << clonePath << endl;
-                            return;
-                        }
-                        partialPaths.push(clonePath);
+                    if(!seenFilms.insert(films[j])) continue;
+                    int actorsAmount;
+                    const int *cast = db.getCastOrdinals(films[j], actorsAmount);
+                    for(int k = 0; k < actorsAmount; k++)
+                    {
+                        if(!seenActors.insert(cast[k])) continue;
+                        distances[cast[k]] = depth;
+                        next.push_back(cast[k]);
+                        if(wanted.contains(cast[k])) remaining--;
                     }
                 }
             }
+            frontier.swap(next);
+        }
+    }
+
+    //the number of films between source and target, or -1 if they aren't connected
+    int getDistance(int target) const { return seenActors.contains(target) ? distances[target] : -1; }
+};
+
+/**
+ * Reads a pairs file, one query per line, each line holding two actors'
+ * names separated by a tab.  Lines naming an actor who isn't in the
+ * database are reported to cerr and skipped.
+ *
+ * @return false if the file couldn't be opened.
+ */
+
+static bool readPairs(const char *fileName, const imdb& db, vector<pairQuery>& queries)
+{
+    ifstream pairs(fileName);
+    if(pairs.fail())
+        return false;
+
+    string line;
+    for(int lineNumber = 1; getline(pairs, line); lineNumber++)
+    {
+        if(line.empty()) continue;
+        size_t tab = line.find('\t');
+        pairQuery query;
+        query.sourceName = line.substr(0, tab);
+        query.targetName = tab == string::npos ? "" : line.substr(tab + 1);
+        int sourceOffset = db.getActorOffset(query.sourceName);
+        int targetOffset = db.getActorOffset(query.targetName);
+        if(sourceOffset == -1 || targetOffset == -1)
+        {
+            cerr << fileName << ":" << lineNumber << ": skipped, since it doesn't name two actors in the database" << endl;
+            continue;
+        }
+        query.source = db.getActorOrdinal(sourceOffset);
+        query.target = db.getActorOrdinal(targetOffset);
+        queries.push_back(query);
+    }
+    return true;
+}
+
+/**
+ * The body of each batch worker: takes the next group of queries sharing
+ * a source, runs one search for all of them, and writes their answers
+ * out before taking another.  groupStarts[g] is where group g begins in
+ * order, which lists the queries' indices sorted by source.
+ */
+
+static void answerGroups(const imdb& db, const vector<pairQuery>& queries, const vector<int>& order,
+                         const vector<int>& groupStarts, atomic<int>& nextGroup, mutex& outputLock)
+{
+    distanceSearch search(db);
+    vector<int> targets;
+    string answers;
+    int group;
+    while((group = nextGroup.fetch_add(1)) < (int) groupStarts.size() - 1)
+    {
+        targets.clear();
+        for(int i = groupStarts[group]; i < groupStarts[group + 1]; i++)
+            targets.push_back(queries[order[i]].target);
+        search.run(queries[order[groupStarts[group]]].source, targets);
+
+        answers.clear();
+        for(int i = groupStarts[group]; i < groupStarts[group + 1]; i++)
+        {
+            const pairQuery& query = queries[order[i]];
+            answers += query.sourceName + "\t" + query.targetName + "\t" + to_string(search.getDistance(query.target)) + "\n";
         }
+        lock_guard<mutex> hold(outputLock);
+        cout << answers;
     }
-    cout << "No path between those two people could be found." << endl;
+}
+
+/**
+ * Answers every query in a pairs file (see readPairs) with a line of the
+ * form <source>\t<target>\t<distance>, where the distance is the number
+ * of films on a shortest path between the two, or -1 if there's no path
+ * at all (no six-film limit applies here).  Queries are grouped by source,
+ * and each distinct source gets a single search, which answers all of its
+ * targets at once.  The groups are shared out among numThreads workers,
+ * and each group's answers are written as soon as its search finishes,
+ * so groups appear in the order they finish, and the queries within a
+ * group in the order they appear in the file.
+ *
+ * @return false if the pairs file couldn't be opened.
+ */
+
+static bool answerPairs(const char *fileName, const imdb& db, int numThreads)
+{
+    vector<pairQuery> queries;
+    if(!readPairs(fileName, db, queries))
+        return false;
+
+    vector<int> order(queries.size());
+    for(int i = 0; i < (int) order.size(); i++)
+        order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return queries[a].source < queries[b].source; });
+    vector<int> groupStarts;
+    for(int i = 0; i < (int) order.size(); i++)
+        if(i == 0 || queries[order[i]].source != queries[order[i - 1]].source)
+            groupStarts.push_back(i);
+    groupStarts.push_back(order.size());
+
+    atomic<int> nextGroup(0);
+    mutex outputLock;
+    numThreads = min(numThreads, (int) groupStarts.size() - 1);
+    vector<thread> workers;
+    for(int t = 1; t < numThreads; t++)
+        workers.push_back(thread(answerGroups, cref(db), cref(queries), cref(order), cref(groupStarts),
+                                 ref(nextGroup), ref(outputLock)));
+    answerGroups(db, queries, order, groupStarts, nextGroup, outputLock);
+    for(int t = 0; t < (int) workers.size(); t++)
+        workers[t].join();
+    cout << flush;
+    return true;
 }
 
 /**
  * Serves as the main entry point for the six-degrees executable.
- * There are no parameters to speak of.
+ * --threads <n> sets the number of threads each level of a search may
+ * be expanded by, which defaults to the number of cores.  Given
+ * --pairs <file>, six-degrees answers every query in the file (see
+ * answerPairs) instead of prompting for names, with that many threads
+ * working on different sources at once.  --hub <table file> maps a table
+ * written by imdb-hub, so that interactive queries involving its hub
+ * actor are answered without a search.  The mapping options imdb-test
+ * takes (see parseMappingOption) are accepted too, in any order.
  *
  * @param argc the number of tokens passed to the command line to
- *             invoke this executable.  It's completely ignored
- *             here, because we don't expect any arguments.
+ *             invoke this executable.
  * @param argv the C strings making up the full command line.
  *             We expect argv[0] to be logically equivalent to
  *             "six-degrees" (or whatever absolute path was used to
- *             invoke the program), but otherwise these are ignored
- *             as well.
+ *             invoke the program), optionally followed by
+ *             the options above.
  * @return 0 if the program ends normally, and undefined otherwise.
  */
 
 int main(int argc, const char *argv[])
 {
-  imdb db(determinePathToData(argv[1])); // inlined in imdb-utils.h
+  int numThreads = max(1u, thread::hardware_concurrency());
+  const char *pairsFileName = NULL;
+  const char *hubFileName = NULL;
+  mappingPolicy policy;
+  for (int i = 1; i < argc; i++) {
+    if (parseMappingOption(argc, argv, i, policy)) continue;
+    if (i + 1 < argc && strcmp(argv[i], "--threads") == 0 && atoi(argv[i + 1]) > 0) {
+      numThreads = atoi(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "--pairs") == 0) {
+      pairsFileName = argv[++i];
+    } else if (i + 1 < argc && strcmp(argv[i], "--hub") == 0) {
+      hubFileName = argv[++i];
+    } else {
+      cerr << "Usage: six-degrees [--threads <n>] [--pairs <file of tab-separated name pairs>]" << endl;
+      cerr << "                   [--hub <table file written by imdb-hub>]" << endl;
+      cerr << "                   " << kMappingUsage << endl;
+      return 1;
+    }
+  }
+
+  imdb db(determinePathToData(argv[1]), policy); // inlined in imdb-utils.h
   if (!db.good()) {
     cout << "Failed to properly initialize the imdb database." << endl;
     cout << "Please check to make sure the source files exist and that you have permission to read them." << endl;
     return 1;
   }
+  db.loadAdjacencyIndex(); // mapped from data/.../adjacency if imdb-index has written one
+
+  if (pairsFileName != NULL) {
+    if (answerPairs(pairsFileName, db, numThreads)) return 0;
+    cerr << "Failed to open the pairs file \"" << pairsFileName << "\"." << endl;
+    return 2;
+  }
+
+  hubTable hub;
+  if (hubFileName != NULL && !hub.load(db, hubFileName))
+    cerr << "Ignoring \"" << hubFileName << "\", which isn't a hub table for this database." << endl;
+
+  searchSide fromStart(db), fromDest(db); // allocated once, reused by every query
+  levelWorkers workers(numThreads);       // started once, and idle between levels
   
   while (true) {
     string source = promptForActor("Actor or actress", db);
@@ -118,7 +723,7 @@ int main(int argc, const char *argv[])
       cout << "Good one.  This is only interesting if you specify two different people." << endl;
     } else {
       // replace the following line by a call to your generateShortestPath routine... 
-      generateShortestPath(source, target, db);
+      generateShortestPath(source, target, db, fromStart, fromDest, workers, hub);
     }
   }
   